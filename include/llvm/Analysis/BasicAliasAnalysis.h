@@ -24,6 +24,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/IR/ValueMap.h"
 #include "llvm/Support/ErrorHandling.h"
 
 namespace llvm {
@@ -33,9 +34,9 @@ class LoopInfo;
 
 /// This is the AA result object for the basic, local, and stateless alias
 /// analysis. It implements the AA query interface in an entirely stateless
-/// manner. As one consequence, it is never invalidated. While it does retain
-/// some storage, that is used as an optimization and not to preserve
-/// information from query to query.
+/// manner. As one consequence, it is never invalidated. The only information
+/// it keeps from query to query is a cache of GEP decompositions, which is
+/// dropped whenever the result is asked to invalidate.
 class BasicAAResult : public AAResultBase<BasicAAResult> {
   friend AAResultBase<BasicAAResult>;
 
@@ -50,6 +51,7 @@ public:
                 LoopInfo *LI = nullptr)
       : AAResultBase(TLI), DL(DL), AC(AC), DT(DT), LI(LI) {}
 
+  // The GEP decomposition cache is not carried over to copies.
   BasicAAResult(const BasicAAResult &Arg)
       : AAResultBase(Arg), DL(Arg.DL), AC(Arg.AC), DT(Arg.DT), LI(Arg.LI) {}
   BasicAAResult(BasicAAResult &&Arg)
@@ -58,8 +60,12 @@ public:
 
   /// Handle invalidation events from the new pass manager.
   ///
-  /// By definition, this result is stateless and so remains valid.
-  bool invalidate(Function &, const PreservedAnalyses &) { return false; }
+  /// By definition, this result is stateless and so remains valid. The
+  /// cached GEP decompositions may be stale though, so drop them.
+  bool invalidate(Function &, const PreservedAnalyses &) {
+    DecomposedGEPCache.clear();
+    return false;
+  }
 
   AliasResult alias(const MemoryLocation &LocA, const MemoryLocation &LocB);
 
@@ -107,11 +113,32 @@ private:
     }
   };
 
+  /// The result of decomposing a pointer with DecomposeGEPExpression.
+  struct DecomposedGEP {
+    const Value *Base;
+    int64_t Offset;
+    SmallVector<VariableGEPIndex, 4> VarIndices;
+    bool MaxLookupReached;
+  };
+
   /// Track alias queries to guard against recursion.
   typedef std::pair<MemoryLocation, MemoryLocation> LocPair;
   typedef SmallDenseMap<LocPair, AliasResult, 8> AliasCacheTy;
   AliasCacheTy AliasCache;
 
+  /// Memoizes GEP decompositions for the lifetime of this result.
+  ///
+  /// Passes such as memdep and DSE ask about the same GEPs over and over, and
+  /// a query that recurses through phis and selects revisits them too. An
+  /// entry is dropped when its GEP is deleted, so a new value allocated at the
+  /// same address never sees it; the whole cache is dropped on invalidation.
+  struct DecomposedGEPCacheConfig : ValueMapConfig<const Value *> {
+    enum { FollowRAUW = false };
+  };
+  typedef ValueMap<const Value *, DecomposedGEP, DecomposedGEPCacheConfig>
+      DecomposedGEPCacheTy;
+  DecomposedGEPCacheTy DecomposedGEPCache;
+
   /// Tracks phi nodes we have visited.
   ///
   /// When interpret "Value" pointer equality as value equality we need to make
@@ -142,6 +169,14 @@ private:
                          SmallVectorImpl<VariableGEPIndex> &VarIndices,
                          bool &MaxLookupReached, const DataLayout &DL,
                          AssumptionCache *AC, DominatorTree *DT);
+
+  /// Like DecomposeGEPExpression, but consults and populates the
+  /// DecomposedGEPCache.
+  const Value *
+  DecomposeGEPExpressionCached(const Value *V, int64_t &BaseOffs,
+                               SmallVectorImpl<VariableGEPIndex> &VarIndices,
+                               bool &MaxLookupReached);
+
   /// \brief A Heuristic for aliasGEP that searches for a constant offset
   /// between the variables.
   ///
@@ -147,6 +147,13 @@ public:
     return DWOCUs[index].get();
   }
 
+  /// Extract the DIEs of all the compile and type units in this context,
+  /// including the DWO ones, on \p NumThreads threads. Units otherwise
+  /// extract their DIEs lazily, one at a time, the first time they are
+  /// queried; this lets tools that walk every unit pay that cost up front and
+  /// in parallel. Must not run concurrently with other uses of the context.
+  void extractAllDIEs(unsigned NumThreads);
+
   const DWARFUnitIndex &getCUIndex();
   const DWARFUnitIndex &getTUIndex();
 
@@ -128,6 +128,17 @@ class DWARFUnit {
   // The compile unit debug information entry items.
   std::vector<DWARFDebugInfoEntryMinimal> DieArray;
 
+  /// An address range covered by the subprogram DIE at DieIndex.
+  struct SubprogramRange {
+    uint64_t LowPC;
+    uint64_t HighPC;
+    uint32_t DieIndex;
+  };
+  /// Non-overlapping address ranges of the subprogram DIEs, sorted by
+  /// address. Built on the first call to getSubprogramForAddress.
+  std::vector<SubprogramRange> SubprogramAddrMap;
+  bool SubprogramAddrMapBuilt;
+
   class DWOHolder {
     object::OwningBinary<object::ObjectFile> DWOFile;
     std::unique_ptr<DWARFContext> DWOContext;
@@ -288,6 +299,10 @@ private:
   /// it was actually constructed.
   bool parseDWO();
 
+  /// buildSubprogramAddrMap - Build the sorted map from addresses to the
+  /// subprogram DIEs covering them.
+  void buildSubprogramAddrMap();
+
   /// getSubprogramForAddress - Returns subprogram DIE with address range
   /// encompassing the provided address. The pointer is alive as long as parsed
   /// compile unit DIEs are not cleared.
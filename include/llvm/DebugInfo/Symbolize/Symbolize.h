@@ -13,12 +13,16 @@
 #ifndef LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 #define LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/ErrorOr.h"
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace llvm {
 namespace symbolize {
@@ -43,6 +47,26 @@ public:
           DefaultArch(DefaultArch) {}
   };
 
+  /// \brief One address to symbolize as part of a batch.
+  struct BatchRequest {
+    enum RequestKind { Code, InlinedCode, Data };
+    RequestKind Kind;
+    /// The module name is not copied; it must outlive the batch.
+    StringRef ModuleName;
+    uint64_t ModuleOffset;
+    BatchRequest(RequestKind Kind, StringRef ModuleName, uint64_t ModuleOffset)
+        : Kind(Kind), ModuleName(ModuleName), ModuleOffset(ModuleOffset) {}
+  };
+
+  /// \brief The result of a BatchRequest. Only the member that matches the
+  /// kind of the request is filled in.
+  struct BatchResult {
+    std::error_code EC;
+    DILineInfo LineInfo;
+    DIInliningInfo InliningInfo;
+    DIGlobal Global;
+  };
+
   LLVMSymbolizer(const Options &Opts = Options()) : Opts(Opts) {}
   ~LLVMSymbolizer() {
     flush();
@@ -54,6 +78,21 @@ public:
                                                uint64_t ModuleOffset);
   ErrorOr<DIGlobal> symbolizeData(const std::string &ModuleName,
                                   uint64_t ModuleOffset);
+
+  /// \brief Symbolize \p Requests on \p NumThreads threads and return the
+  /// results in the order of the requests.
+  ///
+  /// The requests are grouped by module and sorted by offset, so that each
+  /// thread walks the debug info of a module in address order. The debug info
+  /// of a module is parsed lazily and cannot be queried from two threads at
+  /// once, so a module with many requests is split into address ranges that
+  /// are symbolized with private copies of the module.
+  ///
+  /// Only the threads of a single batch are kept apart. The cached modules are
+  /// queried without a lock, so this method must not run concurrently with
+  /// itself, with the single-address symbolize methods or with flush().
+  std::vector<BatchResult> symbolizeBatch(ArrayRef<BatchRequest> Requests,
+                                          unsigned NumThreads);
   void flush();
   static std::string DemangleName(const std::string &Name,
                                   const SymbolizableModule *ModInfo);
@@ -63,8 +102,22 @@ private:
   // corresponding debug info. These objects can be the same.
   typedef std::pair<ObjectFile*, ObjectFile*> ObjectPair;
 
+  DILineInfo symbolizeCode(SymbolizableModule *Info, uint64_t ModuleOffset);
+  DIInliningInfo symbolizeInlinedCode(SymbolizableModule *Info,
+                                      uint64_t ModuleOffset);
+  DIGlobal symbolizeData(SymbolizableModule *Info, uint64_t ModuleOffset);
+  void symbolizeRequest(SymbolizableModule *Info, const BatchRequest &Request,
+                        BatchResult &Result);
+
   ErrorOr<SymbolizableModule *>
   getOrCreateModuleInfo(const std::string &ModuleName);
+
+  /// \brief Builds a new module for \p ModuleName, which may carry an
+  /// architecture suffix (e.g. "binary:x86_64"). The module itself is not
+  /// cached, but the object files it is built from are.
+  ErrorOr<std::unique_ptr<SymbolizableModule>>
+  createModuleInfo(const std::string &ModuleName);
+
   ObjectFile *lookUpDsymFile(const std::string &Path,
                              const MachOObjectFile *ExeObj,
                              const std::string &ArchName);
@@ -96,6 +149,10 @@ private:
   std::map<std::pair<std::string, std::string>, ErrorOr<std::unique_ptr<ObjectFile>>>
       ObjectForUBPathAndArch;
 
+  /// \brief Guards the caches above. Only lookups and insertions hold it;
+  /// queries against a module do not.
+  std::mutex CacheMutex;
+
   Options Opts;
 };
 
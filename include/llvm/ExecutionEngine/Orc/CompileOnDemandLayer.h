@@ -19,6 +19,7 @@
 #include "LambdaResolver.h"
 #include "LogicalDylib.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include <list>
 #include <memory>
@@ -164,6 +165,31 @@ public:
   /// @brief Module partitioning functor.
   typedef std::function<std::set<Function*>(Function&)> PartitioningFtor;
 
+  /// @brief Partitioning function that compiles the requested function only.
+  static std::set<Function*> compileRequested(Function &F) {
+    return std::set<Function*>({&F});
+  }
+
+  /// @brief Partitioning function that speculatively compiles the requested
+  ///        function along with every not-yet-compiled function it calls
+  ///        directly, so that the first calls to those don't have to go
+  ///        through a compile callback.
+  static std::set<Function*> compileWithDirectCallees(Function &F) {
+    std::set<Function*> Part({&F});
+    for (auto &BB : F)
+      for (auto &I : BB) {
+        CallSite CS(&I);
+        if (!CS)
+          continue;
+        // Bodies that have already been compiled have been moved out of the
+        // source module, leaving declarations behind.
+        if (auto *Callee = CS.getCalledFunction())
+          if (!Callee->isDeclaration() && Callee->getParent() == F.getParent())
+            Part.insert(Callee);
+      }
+    return Part;
+  }
+
   /// @brief Builder for IndirectStubsManagers.
   typedef std::function<std::unique_ptr<IndirectStubsMgrT>()>
     IndirectStubsManagerBuilderT;
@@ -239,6 +265,20 @@ public:
     return H->findSymbol(Name, ExportedSymbolsOnly);
   }
 
+  /// @brief Point the stub for the given (mangled) function name at a new
+  ///        body, e.g. one recompiled at a higher optimization level.
+  /// @return true if a stub for FuncName was found and successfully updated.
+  bool updatePointer(const std::string &FuncName, TargetAddress FnBodyAddr) {
+    for (auto &LD : LogicalDylibs)
+      for (auto LMI = LD.logicalModulesBegin(), LME = LD.logicalModulesEnd();
+           LMI != LME; ++LMI) {
+        auto &StubsMgr = *LD.getLogicalModuleResources(LMI).StubsMgr;
+        if (StubsMgr.findStub(FuncName, false))
+          return !StubsMgr.updatePointer(FuncName, FnBodyAddr);
+      }
+    return false;
+  }
+
 private:
 
   template <typename ModulePtrT>
@@ -391,7 +431,15 @@ private:
     // Grab the name of the function being called here.
     std::string CalledFnName = mangle(F.getName(), SrcM.getDataLayout());
 
+    // Drop any functions that have already been compiled from the partition:
+    // their bodies are gone, and their stubs already point at them.
     auto Part = Partition(F);
+    for (auto I = Part.begin(), E = Part.end(); I != E;) {
+      if ((*I)->isDeclaration())
+        I = Part.erase(I);
+      else
+        ++I;
+    }
     auto PartH = emitPartition(LD, LMH, Part);
 
     TargetAddress CalledAddr = 0;
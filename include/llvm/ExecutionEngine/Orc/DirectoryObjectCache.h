@@ -0,0 +1,64 @@
+//===- DirectoryObjectCache.h - Persistent, content-keyed cache -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// An ObjectCache that stores compiled objects in a directory on disk, keyed
+// by a hash of the module's contents and of the code generation settings.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_DIRECTORYOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_ORC_DIRECTORYOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include <string>
+
+namespace llvm {
+namespace orc {
+
+/// @brief Persistent object cache for the Orc compile layers.
+///
+///   Objects are stored in CacheDir under a name derived from an MD5 hash of
+/// the module's bitcode (which covers its target triple and data layout) and
+/// of ConfigKey. ConfigKey should describe everything else that affects the
+/// generated code, e.g. the CPU, the target features and the optimization
+/// level, so that changing those settings misses the cache rather than
+/// loading stale objects. Because the key is derived from the IR itself, the
+/// cache can be shared by processes that recreate the same modules on
+/// restart.
+///
+///   To use it with an IRCompileLayer, pass it to setObjectCache.
+class DirectoryObjectCache : public ObjectCache {
+public:
+  DirectoryObjectCache(std::string CacheDir, std::string ConfigKey = "");
+
+  /// @brief Write Obj to the cache file for M. Failures to write are ignored:
+  ///        the object will simply be recompiled next time.
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+
+  /// @brief Return the cached object for M, or null if there is none.
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// @brief Return the path of the cache file that would hold the object
+  ///        for M.
+  std::string getCachePath(const Module &M);
+
+private:
+  std::string CacheDir;
+  std::string ConfigKey;
+
+  // Paths computed in getObject, reused when the same module is then
+  // compiled and passed to notifyObjectCompiled so that it is hashed once.
+  DenseMap<const Module*, std::string> PendingPaths;
+};
+
+} // End namespace orc.
+} // End namespace llvm.
+
+#endif // LLVM_EXECUTIONENGINE_ORC_DIRECTORYOBJECTCACHE_H
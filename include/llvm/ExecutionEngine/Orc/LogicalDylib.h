@@ -77,6 +77,9 @@ public:
     return LMH->Resources;
   }
 
+  LogicalModuleHandle logicalModulesBegin() { return LogicalModules.begin(); }
+  LogicalModuleHandle logicalModulesEnd() { return LogicalModules.end(); }
+
   BaseLayerHandleIterator moduleHandlesBegin(LogicalModuleHandle LMH) {
     return LMH->BaseLayerHandles.begin();
   }
@@ -104,41 +104,47 @@ public:
 
       DEBUG(dbgs() << "Allocator " << Id << " reserved:\n");
 
-      if (CodeSize != 0) {
-        std::error_code EC = Client.reserveMem(Unmapped.back().RemoteCodeAddr,
-                                               Id, CodeSize, CodeAlign);
-        // FIXME; Add error to poll.
-        assert(!EC && "Failed reserving remote memory.");
-        (void)EC;
+      // Send all of the reservation requests together, then collect the
+      // replies, which come back in request order. If any step fails the
+      // client marks the channel dead, so stopping early cannot leave an
+      // unread reply for a later call to pick up.
+      std::error_code EC;
+      if (CodeSize != 0)
+        EC = Client.appendReserveMem(Id, CodeSize, CodeAlign);
+      if (!EC && RODataSize != 0)
+        EC = Client.appendReserveMem(Id, RODataSize, RODataAlign);
+      if (!EC && RWDataSize != 0)
+        EC = Client.appendReserveMem(Id, RWDataSize, RWDataAlign);
+      if (!EC)
+        EC = Client.sendQueuedCalls();
+
+      if (!EC && CodeSize != 0) {
+        EC = Client.readReserveMemResponse(Unmapped.back().RemoteCodeAddr);
         DEBUG(dbgs() << "  code: "
                      << format("0x%016x", Unmapped.back().RemoteCodeAddr)
                      << " (" << CodeSize << " bytes, alignment " << CodeAlign
                      << ")\n");
       }
 
-      if (RODataSize != 0) {
-        std::error_code EC = Client.reserveMem(Unmapped.back().RemoteRODataAddr,
-                                               Id, RODataSize, RODataAlign);
-        // FIXME; Add error to poll.
-        assert(!EC && "Failed reserving remote memory.");
-        (void)EC;
+      if (!EC && RODataSize != 0) {
+        EC = Client.readReserveMemResponse(Unmapped.back().RemoteRODataAddr);
         DEBUG(dbgs() << "  ro-data: "
                      << format("0x%016x", Unmapped.back().RemoteRODataAddr)
                      << " (" << RODataSize << " bytes, alignment "
                      << RODataAlign << ")\n");
       }
 
-      if (RWDataSize != 0) {
-        std::error_code EC = Client.reserveMem(Unmapped.back().RemoteRWDataAddr,
-                                               Id, RWDataSize, RWDataAlign);
-        // FIXME; Add error to poll.
-        assert(!EC && "Failed reserving remote memory.");
-        (void)EC;
+      if (!EC && RWDataSize != 0) {
+        EC = Client.readReserveMemResponse(Unmapped.back().RemoteRWDataAddr);
         DEBUG(dbgs() << "  rw-data: "
                      << format("0x%016x", Unmapped.back().RemoteRWDataAddr)
                      << " (" << RWDataSize << " bytes, alignment "
                      << RWDataAlign << ")\n");
       }
+
+      // FIXME; Add error to poll.
+      assert(!EC && "Failed reserving remote memory.");
+      (void)EC;
     }
 
     bool needsToReserveAllocationSpace() override { return true; }
@@ -269,6 +275,13 @@ public:
       }
       UnfinalizedEHFrames.clear();
 
+      // The writes, protection changes and EH frame registrations above were
+      // only queued. Send them to the target as one batch.
+      auto EC = Client.sendQueuedCalls();
+      // FIXME: Add error poll.
+      assert(!EC && "Failed to send finalization requests.");
+      (void)EC;
+
       return false;
     }
 
@@ -730,28 +743,55 @@ private:
     return std::error_code();
   }
 
+  // The target does not reply to RegisterEHFrames, SetProtections, WriteMem
+  // or WritePtr, so those calls are only queued on the channel. They reach
+  // the target, in order, with the next call that is sent (every call that
+  // waits for a reply is sent), or when sendQueuedCalls is used.
+
   std::error_code registerEHFrames(TargetAddress &RAddr, uint32_t Size) {
-    return call<RegisterEHFrames>(Channel, RAddr, Size);
+    return appendCall<RegisterEHFrames>(Channel, RAddr, Size);
   }
 
-  std::error_code reserveMem(TargetAddress &RemoteAddr,
-                             ResourceIdMgr::ResourceId Id, uint64_t Size,
-                             uint32_t Align) {
-
+  /// Queue a ReserveMem request. The reply must be collected with
+  /// readReserveMemResponse once the request has been sent; replies arrive in
+  /// the order the requests were made.
+  ///
+  /// Once a request has been queued the channel is only in step with the
+  /// target if every reply is read, so a failure in any of these three calls
+  /// is recorded as an 'out-of-band' error and fails all later calls.
+  std::error_code appendReserveMem(ResourceIdMgr::ResourceId Id, uint64_t Size,
+                                   uint32_t Align) {
     // Check for an 'out-of-band' error, e.g. from an MM destructor.
     if (ExistingError)
       return ExistingError;
 
-    if (std::error_code EC = call<ReserveMem>(Channel, Id, Size, Align))
-      return EC;
+    if (auto EC = appendCall<ReserveMem>(Channel, Id, Size, Align))
+      ExistingError = EC;
+    return ExistingError;
+  }
+
+  std::error_code readReserveMemResponse(TargetAddress &RemoteAddr) {
+    if (ExistingError)
+      return ExistingError;
 
-    return expect<ReserveMemResponse>(Channel, readArgs(RemoteAddr));
+    if (auto EC = expect<ReserveMemResponse>(Channel, readArgs(RemoteAddr)))
+      ExistingError = EC;
+    return ExistingError;
+  }
+
+  std::error_code sendQueuedCalls() {
+    if (ExistingError)
+      return ExistingError;
+
+    if (auto EC = Channel.send())
+      ExistingError = EC;
+    return ExistingError;
   }
 
   std::error_code setProtections(ResourceIdMgr::ResourceId Id,
                                  TargetAddress RemoteSegAddr,
                                  unsigned ProtFlags) {
-    return call<SetProtections>(Channel, Id, RemoteSegAddr, ProtFlags);
+    return appendCall<SetProtections>(Channel, Id, RemoteSegAddr, ProtFlags);
   }
 
   std::error_code writeMem(TargetAddress Addr, const char *Src, uint64_t Size) {
@@ -759,15 +799,11 @@ private:
     if (ExistingError)
       return ExistingError;
 
-    // Make the send call.
-    if (auto EC = call<WriteMem>(Channel, Addr, Size))
-      return EC;
-
-    // Follow this up with the section contents.
-    if (auto EC = Channel.appendBytes(Src, Size))
+    // Queue the call, then follow it up with the section contents.
+    if (auto EC = appendCall<WriteMem>(Channel, Addr, Size))
       return EC;
 
-    return Channel.send();
+    return Channel.appendBytes(Src, Size);
   }
 
   std::error_code writePointer(TargetAddress Addr, TargetAddress PtrVal) {
@@ -775,7 +811,7 @@ private:
     if (ExistingError)
       return ExistingError;
 
-    return call<WritePtr>(Channel, Addr, PtrVal);
+    return appendCall<WritePtr>(Channel, Addr, PtrVal);
   }
 
   static std::error_code doNothing() { return std::error_code(); }
@@ -375,7 +375,7 @@ private:
     DEBUG(dbgs() << "  Reading " << Size << " bytes from "
                  << format("0x%016x", RSrc) << "\n");
 
-    if (auto EC = call<ReadMemResponse>(Channel))
+    if (auto EC = appendCall<ReadMemResponse>(Channel))
       return EC;
 
     if (auto EC = Channel.appendBytes(Src, Size))
@@ -39,7 +39,20 @@ class SectionMemoryManager : public RTDyldMemoryManager {
   void operator=(const SectionMemoryManager&) = delete;
 
 public:
-  SectionMemoryManager() { }
+  /// \brief Create a memory manager.
+  ///
+  /// If \p SlabSize is non-zero, memory is requested from the system in
+  /// regions of at least that many bytes, and later sections are carved out
+  /// of the space left over. This cuts down on system calls and address space
+  /// fragmentation for clients that load many small objects through one
+  /// memory manager. Space left over in pages that have already had their
+  /// permissions applied is never reused.
+  ///
+  /// Memory is only returned to the system when the memory manager is
+  /// destroyed, so a slab that is mostly unused stays mapped until then. The
+  /// default of zero maps no more than each allocation needs, rounded up to
+  /// whole pages, as before slabs were added.
+  explicit SectionMemoryManager(uintptr_t SlabSize = 0) : SlabSize(SlabSize) { }
   ~SectionMemoryManager() override;
 
   /// \brief Allocates a memory block of (at least) the given size suitable for
@@ -116,6 +129,8 @@ private:
   MemoryGroup CodeMem;
   MemoryGroup RWDataMem;
   MemoryGroup RODataMem;
+
+  uintptr_t SlabSize;
 };
 
 }
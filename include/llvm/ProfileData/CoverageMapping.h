@@ -52,6 +52,7 @@ class IndexedInstrProfReader;
 namespace coverage {
 
 class CoverageMappingReader;
+class BinaryCoverageReader;
 
 class CoverageMapping;
 struct CounterExpressions;
@@ -426,10 +427,18 @@ public:
   load(CoverageMappingReader &CoverageReader,
        IndexedInstrProfReader &ProfileReader);
 
+  /// \brief Load the coverage mapping using the given readers, decoding the
+  /// function records on up to \p NumThreads threads.
+  ///
+  /// The result is the same as that of a sequential load.
+  static ErrorOr<std::unique_ptr<CoverageMapping>>
+  load(BinaryCoverageReader &CoverageReader,
+       IndexedInstrProfReader &ProfileReader, unsigned NumThreads);
+
   /// \brief Load the coverage mapping from the given files.
   static ErrorOr<std::unique_ptr<CoverageMapping>>
   load(StringRef ObjectFilename, StringRef ProfileFilename,
-       StringRef Arch = StringRef());
+       StringRef Arch = StringRef(), unsigned NumThreads = 1);
 
   /// \brief The number of functions that couldn't have their profiles mapped.
   ///
@@ -175,6 +175,20 @@ public:
          StringRef Arch);
 
   std::error_code readNextRecord(CoverageMappingRecord &Record) override;
+
+  /// \brief The number of function records in the coverage mapping.
+  size_t getNumRecords() const { return MappingRecords.size(); }
+
+  /// \brief Decode the function record at \p Index into \p Record, storing
+  /// its filenames, expressions and regions in the given vectors.
+  ///
+  /// Unlike readNextRecord, this leaves the reader's state untouched, so
+  /// distinct records can be decoded on several threads at once.
+  std::error_code
+  readRecord(size_t Index, CoverageMappingRecord &Record,
+             std::vector<StringRef> &FunctionsFilenames,
+             std::vector<CounterExpression> &Expressions,
+             std::vector<CounterMappingRegion> &MappingRegions) const;
 };
 
 } // end namespace coverage
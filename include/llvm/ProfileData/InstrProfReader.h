@@ -274,6 +274,21 @@ public:
                               const unsigned char *const End);
   data_type ReadData(StringRef K, const unsigned char *D, offset_type N);
 
+  /// Read the hash and the counters of the record at D, leaving D at the
+  /// record's value profile data. N is the size of all the data for the key.
+  bool readCounts(const unsigned char *&D, const unsigned char *const End,
+                  offset_type N, uint64_t &Hash,
+                  std::vector<uint64_t> &Counts);
+  /// Advance D past the value profile data of a record without decoding it.
+  bool skipValueProfilingData(const unsigned char *&D,
+                              const unsigned char *const End);
+  /// Read only the record with the given hash out of the data for key K.
+  /// Value profile data is decoded only if ReadValueData is true; the other
+  /// records for the key are skipped without being materialized.
+  std::error_code ReadRecord(StringRef K, const unsigned char *D,
+                             offset_type N, uint64_t FuncHash,
+                             InstrProfRecord &Record, bool ReadValueData);
+
   // Used for testing purpose only.
   void setValueProfDataEndianness(support::endianness Endianness) {
     ValueProfDataEndianness = Endianness;
@@ -287,6 +302,11 @@ struct InstrProfReaderIndexBase {
   // Read all the profile records with the key equal to FuncName
   virtual std::error_code getRecords(StringRef FuncName,
                                      ArrayRef<InstrProfRecord> &Data) = 0;
+  // Read the single profile record with the key equal to FuncName and the
+  // given hash, decoding its value profile data only if ReadValueData is set.
+  virtual std::error_code getRecord(StringRef FuncName, uint64_t FuncHash,
+                                    InstrProfRecord &Record,
+                                    bool ReadValueData) = 0;
   virtual void advanceToNextKey() = 0;
   virtual bool atEnd() const = 0;
   virtual void setValueProfDataEndianness(support::endianness Endianness) = 0;
@@ -315,6 +335,9 @@ public:
   std::error_code getRecords(ArrayRef<InstrProfRecord> &Data) override;
   std::error_code getRecords(StringRef FuncName,
                              ArrayRef<InstrProfRecord> &Data) override;
+  std::error_code getRecord(StringRef FuncName, uint64_t FuncHash,
+                            InstrProfRecord &Record,
+                            bool ReadValueData) override;
   void advanceToNextKey() override { RecordIterator++; }
   bool atEnd() const override {
     return RecordIterator == HashTable->data_end();
@@ -360,7 +383,9 @@ public:
   ErrorOr<InstrProfRecord> getInstrProfRecord(StringRef FuncName,
                                               uint64_t FuncHash);
 
-  /// Fill Counts with the profile data for the given function name.
+  /// Fill Counts with the profile data for the given function name. This only
+  /// decodes the counters of the matching record; value profile data is left
+  /// in the mapped file.
   std::error_code getFunctionCounts(StringRef FuncName, uint64_t FuncHash,
                                     std::vector<uint64_t> &Counts);
 
@@ -16,10 +16,14 @@
 #define LLVM_PROFILEDATA_INSTRPROFWRITER_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ProfileData/InstrProf.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <functional>
+#include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -29,32 +33,61 @@ class InstrProfWriter {
 public:
   typedef SmallDenseMap<uint64_t, InstrProfRecord, 1> ProfilingData;
 
+  typedef std::function<void(std::error_code, StringRef)> WarningHandler;
+
 private:
   StringMap<ProfilingData> FunctionData;
   uint64_t MaxFunctionCount;
+  /// Approximate number of bytes held by FunctionData, and the number past
+  /// which it is spilled to disk (0 if it never is).
+  uint64_t MemoryUsage;
+  uint64_t MemoryLimit;
+  /// Temporary files holding the spilled runs of records, each sorted by
+  /// function name and hash.
+  std::vector<std::string> SpillFiles;
+  /// Reports the records of spilled runs that cannot be merged.
+  WarningHandler SpillWarn;
 
 public:
-  InstrProfWriter() : MaxFunctionCount(0) {}
+  InstrProfWriter()
+      : MaxFunctionCount(0), MemoryUsage(0), MemoryLimit(0) {}
+  ~InstrProfWriter();
+
+  /// Keep roughly at most \p Bytes of records in memory. Past that, the
+  /// records are written to a sorted run in a temporary file, and the runs
+  /// are merged when the profile is written. Merge errors that can only be
+  /// found then are passed to \p Warn.
+  void setMemoryLimit(uint64_t Bytes, WarningHandler Warn = nullptr);
 
   /// Add function counts for the given function. If there are already counts
   /// for this function and the hash and number of counts match, each counter is
   /// summed. Optionally scale counts by \p Weight.
   std::error_code addRecord(InstrProfRecord &&I, uint64_t Weight = 1);
-  /// Write the profile to \c OS
-  void write(raw_fd_ostream &OS);
-  /// Write the profile in text format to \c OS
-  void writeText(raw_fd_ostream &OS);
+  /// Merge existing function counts from the given writer, leaving \p IPW
+  /// empty. \p Warn is called with the name of each function whose records
+  /// could not be merged.
+  void mergeRecordsFromWriter(
+      InstrProfWriter &&IPW,
+      function_ref<void(std::error_code, StringRef)> Warn);
+  /// Write the profile to \c OS. Fails only if records have been spilled and
+  /// the runs cannot be written or read back.
+  std::error_code write(raw_fd_ostream &OS);
+  /// Write the profile in text format to \c OS. Fails as write() does.
+  std::error_code writeText(raw_fd_ostream &OS);
   /// Write \c Record in text format to \c OS
   static void writeRecordInText(const InstrProfRecord &Record,
                                 InstrProfSymtab &Symtab, raw_fd_ostream &OS);
-  /// Write the profile, returning the raw data. For testing.
+  /// Write the profile, returning the raw data, or null if write() would
+  /// fail. For testing.
   std::unique_ptr<MemoryBuffer> writeBuffer();
 
   // Internal interface for testing purpose only.
   void setValueProfDataEndianness(support::endianness Endianness);
 
 private:
-  void writeImpl(ProfOStream &OS);
+  std::error_code writeImpl(ProfOStream &OS);
+  /// Write FunctionData to a new sorted run and clear it.
+  std::error_code spill();
 };
 
 } // end namespace llvm
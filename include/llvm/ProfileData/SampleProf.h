@@ -74,7 +74,11 @@ static inline uint64_t SPMagic() {
          uint64_t('2') << (64 - 56) | uint64_t(0xff);
 }
 
-static inline uint64_t SPVersion() { return 102; }
+static inline uint64_t SPVersion() { return 103; }
+
+/// The last binary format version without a function index. Profiles in this
+/// version can still be read, but only as a whole.
+static inline uint64_t SPVersionNoIndex() { return 102; }
 
 /// Represents the relative location of an instruction.
 ///
@@ -135,6 +135,18 @@
 //    NAMES
 //        A NUL-separated list of SIZE strings.
 //
+// FUNCTION INDEX [only from version 103]
+//    TOTAL_SAMPLES (uint64_t)
+//        Sum of the total samples of all the top-level functions.
+//    SIZE (uint32_t)
+//        Number of entries in the index.
+//    ENTRIES
+//        One entry for each top-level FUNCTION BODY below:
+//          NAME_IDX (uint32_t)
+//            Index into the name table indicating the function name.
+//          OFFSET (uint64_t)
+//            Offset in bytes of the function body from the end of the index.
+//
 // FUNCTION BODY (one for each uninlined function body present in the profile)
 //    HEAD_SAMPLES (uint64_t) [only for top-level functions]
 //        Total number of samples collected at the head (prologue) of the
@@ -184,6 +196,8 @@
 #ifndef LLVM_PROFILEDATA_SAMPLEPROFREADER_H
 #define LLVM_PROFILEDATA_SAMPLEPROFREADER_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
@@ -242,6 +256,23 @@ public:
   /// \brief Read sample profiles from the associated file.
   virtual std::error_code read() = 0;
 
+  /// \brief Read the sample profiles of just the functions in \p FuncNames.
+  ///
+  /// Formats that carry a function index decode only those profiles. The
+  /// others read the whole file.
+  virtual std::error_code readFunctions(ArrayRef<StringRef> FuncNames) {
+    return read();
+  }
+
+  /// \brief Return the sum of the total samples of all the functions in the
+  /// profile, including those that have not been read.
+  virtual uint64_t getTotalSamples() {
+    uint64_t Total = 0;
+    for (const auto &I : Profiles)
+      Total += I.second.getTotalSamples();
+    return Total;
+  }
+
   /// \brief Print the profile for \p FName on stream \p OS.
   void dumpFunctionProfile(StringRef FName, raw_ostream &OS = dbgs());
 
@@ -303,7 +334,8 @@ public:
 class SampleProfileReaderBinary : public SampleProfileReader {
 public:
   SampleProfileReaderBinary(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
-      : SampleProfileReader(std::move(B), C), Data(nullptr), End(nullptr) {}
+      : SampleProfileReader(std::move(B), C), Data(nullptr), End(nullptr),
+        FuncBodiesStart(nullptr), HasFuncIndex(false), TotalSamples(0) {}
 
   /// \brief Read and validate the file header.
   std::error_code readHeader() override;
@@ -311,6 +343,12 @@ public:
   /// \brief Read sample profiles from the associated file.
   std::error_code read() override;
 
+  /// \brief Read the sample profiles of just the functions in \p FuncNames,
+  /// using the function index to seek to each one.
+  std::error_code readFunctions(ArrayRef<StringRef> FuncNames) override;
+
+  uint64_t getTotalSamples() override;
+
   /// \brief Return true if \p Buffer is in the format supported by this class.
   static bool hasFormat(const MemoryBuffer &Buffer);
 
@@ -340,6 +378,12 @@ protected:
   /// Read the contents of the given profile instance.
   std::error_code readProfile(FunctionSamples &FProfile);
 
+  /// Read the top-level function body at the current location.
+  std::error_code readFuncProfile();
+
+  /// Read the function index that follows the name table.
+  std::error_code readFuncIndex();
+
   /// \brief Points to the current location in the buffer.
   const uint8_t *Data;
 
@@ -348,6 +392,18 @@ protected:
 
   /// Function name table.
   std::vector<StringRef> NameTable;
+
+  /// \brief Points to the first top-level function body.
+  const uint8_t *FuncBodiesStart;
+
+  /// True if the profile has a function index.
+  bool HasFuncIndex;
+
+  /// Sum of the total samples of all the functions, from the function index.
+  uint64_t TotalSamples;
+
+  /// Offset of each top-level function body from FuncBodiesStart.
+  DenseMap<StringRef, uint64_t> FuncOffsetTable;
 };
 
 typedef SmallVector<FunctionSamples *, 10> InlineCallStack;
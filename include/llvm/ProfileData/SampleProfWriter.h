@@ -39,7 +39,7 @@ public:
   /// Write all the sample profiles in the given map of samples.
   ///
   /// \returns status code of the file update operation.
-  std::error_code write(const StringMap<FunctionSamples> &ProfileMap) {
+  virtual std::error_code write(const StringMap<FunctionSamples> &ProfileMap) {
     if (std::error_code EC = writeHeader(ProfileMap))
       return EC;
 
@@ -107,14 +107,19 @@ class SampleProfileWriterBinary : public SampleProfileWriter {
 public:
   std::error_code write(StringRef F, const FunctionSamples &S) override;
 
+  /// Write all the sample profiles in \p ProfileMap, preceded by an index
+  /// of the function bodies so that readers can load single functions.
+  std::error_code write(const StringMap<FunctionSamples> &ProfileMap) override;
+
 protected:
   SampleProfileWriterBinary(std::unique_ptr<raw_ostream> &OS)
       : SampleProfileWriter(OS), NameTable() {}
 
   std::error_code
   writeHeader(const StringMap<FunctionSamples> &ProfileMap) override;
-  std::error_code writeNameIdx(StringRef FName);
-  std::error_code writeBody(StringRef FName, const FunctionSamples &S);
+  std::error_code writeNameIdx(raw_ostream &OS, StringRef FName);
+  std::error_code writeBody(raw_ostream &OS, StringRef FName,
+                            const FunctionSamples &S);
 
 private:
   void addName(StringRef FName);
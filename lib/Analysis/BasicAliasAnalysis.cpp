@@ -50,6 +50,8 @@ static cl::opt<bool> EnableRecPhiAnalysis("basicaa-recphi", cl::Hidden,
 STATISTIC(SearchLimitReached, "Number of times the limit to "
                               "decompose GEPs is reached");
 STATISTIC(SearchTimes, "Number of times a GEP is decomposed");
+STATISTIC(DecomposedGEPCacheHits,
+          "Number of GEP decompositions reused from the cache");
 
 /// Cutoff after which to stop analysing a set of phi nodes potentially involved
 /// in a cycle. Because we are analysing 'through' phi nodes, we need to be
@@ -467,6 +469,30 @@ static bool isObjectSize(const Value *V, uint64_t Size, const DataLayout &DL,
   return V;
 }
 
+const Value *BasicAAResult::DecomposeGEPExpressionCached(
+    const Value *V, int64_t &BaseOffs,
+    SmallVectorImpl<VariableGEPIndex> &VarIndices, bool &MaxLookupReached) {
+  auto CacheIt = DecomposedGEPCache.find(V);
+  if (CacheIt == DecomposedGEPCache.end()) {
+    DecomposedGEP Decomposed;
+    Decomposed.Base = DecomposeGEPExpression(
+        V, Decomposed.Offset, Decomposed.VarIndices,
+        Decomposed.MaxLookupReached, DL, &AC, DT);
+    CacheIt =
+        DecomposedGEPCache.insert(std::make_pair(V, std::move(Decomposed)))
+            .first;
+  } else {
+    DecomposedGEPCacheHits++;
+  }
+
+  const DecomposedGEP &Decomposed = CacheIt->second;
+  BaseOffs = Decomposed.Offset;
+  VarIndices.append(Decomposed.VarIndices.begin(),
+                    Decomposed.VarIndices.end());
+  MaxLookupReached = Decomposed.MaxLookupReached;
+  return Decomposed.Base;
+}
+
 /// Returns whether the given pointer value points to memory that is local to
 /// the function, with global constants being considered local to all
 /// functions.
@@ -931,12 +957,10 @@ AliasResult BasicAAResult::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
         int64_t GEP2BaseOffset;
         bool GEP2MaxLookupReached;
         SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
-        const Value *GEP2BasePtr =
-            DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices,
-                                   GEP2MaxLookupReached, DL, &AC, DT);
-        const Value *GEP1BasePtr =
-            DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
-                                   GEP1MaxLookupReached, DL, &AC, DT);
+        const Value *GEP2BasePtr = DecomposeGEPExpressionCached(
+            GEP2, GEP2BaseOffset, GEP2VariableIndices, GEP2MaxLookupReached);
+        const Value *GEP1BasePtr = DecomposeGEPExpressionCached(
+            GEP1, GEP1BaseOffset, GEP1VariableIndices, GEP1MaxLookupReached);
         // DecomposeGEPExpression and GetUnderlyingObject should return the
         // same result except when DecomposeGEPExpression has no DataLayout.
         // FIXME: They always have a DataLayout, so this should become an
@@ -964,16 +988,14 @@ AliasResult BasicAAResult::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
     // Otherwise, we have a MustAlias.  Since the base pointers alias each other
     // exactly, see if the computed offset from the common pointer tells us
     // about the relation of the resulting pointer.
-    const Value *GEP1BasePtr =
-        DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
-                               GEP1MaxLookupReached, DL, &AC, DT);
+    const Value *GEP1BasePtr = DecomposeGEPExpressionCached(
+        GEP1, GEP1BaseOffset, GEP1VariableIndices, GEP1MaxLookupReached);
 
     int64_t GEP2BaseOffset;
     bool GEP2MaxLookupReached;
     SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
-    const Value *GEP2BasePtr =
-        DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices,
-                               GEP2MaxLookupReached, DL, &AC, DT);
+    const Value *GEP2BasePtr = DecomposeGEPExpressionCached(
+        GEP2, GEP2BaseOffset, GEP2VariableIndices, GEP2MaxLookupReached);
 
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -1021,9 +1043,8 @@ AliasResult BasicAAResult::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
       // with the first operand of the getelementptr".
       return R;
 
-    const Value *GEP1BasePtr =
-        DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
-                               GEP1MaxLookupReached, DL, &AC, DT);
+    const Value *GEP1BasePtr = DecomposeGEPExpressionCached(
+        GEP1, GEP1BaseOffset, GEP1VariableIndices, GEP1MaxLookupReached);
 
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -58,12 +58,38 @@ CFLAAResult::CFLAAResult(CFLAAResult &&Arg) : AAResultBase(std::move(Arg)) {}
 
 // \brief Information we have about a function and would like to keep around
 struct CFLAAResult::FunctionInfo {
+  // \brief Two parameters that may alias each other after a call, along with
+  // the attributes of their sets.
+  struct ParamRelation {
+    unsigned From;
+    unsigned To;
+    StratifiedAttrs Attrs;
+
+    ParamRelation(unsigned From, unsigned To, StratifiedAttrs Attrs)
+        : From(From), To(To), Attrs(Attrs) {}
+  };
+
+  // \brief Describes how a call to this function may make its arguments and
+  // its result alias, so that callers don't have to walk our sets at every
+  // call site.
+  struct InterfaceSummary {
+    unsigned NumParams;
+    // Parameters that may alias a returned value.
+    SmallVector<unsigned, 4> RetAliasingParams;
+    SmallVector<ParamRelation, 8> ParamRelations;
+  };
+
   StratifiedSets<Value *> Sets;
   // Lots of functions have < 4 returns. Adjust as necessary.
   SmallVector<Value *, 4> ReturnedValues;
+  // None if the function can't be used for interprocedural analysis.
+  Optional<InterfaceSummary> Summary;
 
   FunctionInfo(StratifiedSets<Value *> &&S, SmallVector<Value *, 4> &&RV)
       : Sets(std::move(S)), ReturnedValues(std::move(RV)) {}
+
+  // \brief Computes Summary for the given function from Sets.
+  void summarize(Function &Fn);
 };
 
 // Try to go from a Value* to a Function*. Never returns nullptr.
@@ -253,31 +279,6 @@ public:
     return Fn->isDeclaration() || !Fn->hasLocalLinkage();
   }
 
-  // Gets whether the sets at Index1 above, below, or equal to the sets at
-  // Index2. Returns None if they are not in the same set chain.
-  static Optional<Level> getIndexRelation(const StratifiedSets<Value *> &Sets,
-                                          StratifiedIndex Index1,
-                                          StratifiedIndex Index2) {
-    if (Index1 == Index2)
-      return Level::Same;
-
-    const auto *Current = &Sets.getLink(Index1);
-    while (Current->hasBelow()) {
-      if (Current->Below == Index2)
-        return Level::Below;
-      Current = &Sets.getLink(Current->Below);
-    }
-
-    Current = &Sets.getLink(Index1);
-    while (Current->hasAbove()) {
-      if (Current->Above == Index2)
-        return Level::Above;
-      Current = &Sets.getLink(Current->Above);
-    }
-
-    return NoneType();
-  }
-
   bool
   tryInterproceduralAnalysis(const SmallVectorImpl<Function *> &Fns,
                              Value *FuncValue,
@@ -296,55 +297,21 @@ public:
       if (isFunctionExternal(Fn) || Fn->isVarArg())
         return false;
       auto &MaybeInfo = AA.ensureCached(Fn);
-      if (!MaybeInfo.hasValue())
+      if (!MaybeInfo.hasValue() || !MaybeInfo->Summary.hasValue())
         return false;
     }
 
     SmallVector<Value *, ExpectedMaxArgs> Arguments(Args.begin(), Args.end());
-    SmallVector<StratifiedInfo, ExpectedMaxArgs> Parameters;
     for (auto *Fn : Fns) {
-      auto &Info = *AA.ensureCached(Fn);
-      auto &Sets = Info.Sets;
-      auto &RetVals = Info.ReturnedValues;
-
-      Parameters.clear();
-      for (auto &Param : Fn->args()) {
-        auto MaybeInfo = Sets.find(&Param);
-        // Did a new parameter somehow get added to the function/slip by?
-        if (!MaybeInfo.hasValue())
-          return false;
-        Parameters.push_back(*MaybeInfo);
-      }
+      auto &Summary = *AA.ensureCached(Fn)->Summary;
+      if (Summary.NumParams != Arguments.size())
+        return false;
 
       // Adding an edge from argument -> return value for each parameter that
       // may alias the return value
-      for (unsigned I = 0, E = Parameters.size(); I != E; ++I) {
-        auto &ParamInfo = Parameters[I];
-        auto &ArgVal = Arguments[I];
-        bool AddEdge = false;
-        StratifiedAttrs Externals;
-        for (unsigned X = 0, XE = RetVals.size(); X != XE; ++X) {
-          auto MaybeInfo = Sets.find(RetVals[X]);
-          if (!MaybeInfo.hasValue())
-            return false;
-
-          auto &RetInfo = *MaybeInfo;
-          auto RetAttrs = Sets.getLink(RetInfo.Index).Attrs;
-          auto ParamAttrs = Sets.getLink(ParamInfo.Index).Attrs;
-          auto MaybeRelation =
-              getIndexRelation(Sets, ParamInfo.Index, RetInfo.Index);
-          if (MaybeRelation.hasValue()) {
-            AddEdge = true;
-            Externals |= RetAttrs | ParamAttrs;
-          }
-        }
-        if (AddEdge)
-          Output.push_back(Edge(FuncValue, ArgVal, EdgeType::Assign,
-                                StratifiedAttrs().flip()));
-      }
-
-      if (Parameters.size() != Arguments.size())
-        return false;
+      for (unsigned I : Summary.RetAliasingParams)
+        Output.push_back(Edge(FuncValue, Arguments[I], EdgeType::Assign,
+                              StratifiedAttrs().flip()));
 
       // Adding edges between arguments for arguments that may end up aliasing
       // each other. This is necessary for functions such as
@@ -352,24 +319,10 @@ public:
       // (Technically, the proper sets for this would be those below
       // Arguments[I] and Arguments[X], but our algorithm will produce
       // extremely similar, and equally correct, results either way)
-      for (unsigned I = 0, E = Arguments.size(); I != E; ++I) {
-        auto &MainVal = Arguments[I];
-        auto &MainInfo = Parameters[I];
-        auto &MainAttrs = Sets.getLink(MainInfo.Index).Attrs;
-        for (unsigned X = I + 1; X != E; ++X) {
-          auto &SubInfo = Parameters[X];
-          auto &SubVal = Arguments[X];
-          auto &SubAttrs = Sets.getLink(SubInfo.Index).Attrs;
-          auto MaybeRelation =
-              getIndexRelation(Sets, MainInfo.Index, SubInfo.Index);
-
-          if (!MaybeRelation.hasValue())
-            continue;
-
-          auto NewAttrs = SubAttrs | MainAttrs;
-          Output.push_back(Edge(MainVal, SubVal, EdgeType::Assign, NewAttrs));
-        }
-      }
+      for (const auto &Relation : Summary.ParamRelations)
+        Output.push_back(Edge(Arguments[Relation.From],
+                              Arguments[Relation.To], EdgeType::Assign,
+                              Relation.Attrs));
     }
     return true;
   }
@@ -902,6 +855,78 @@ static bool canSkipAddingToSets(Value *Val) {
   return false;
 }
 
+// Gets whether the sets at Index1 above, below, or equal to the sets at
+// Index2. Returns None if they are not in the same set chain.
+static Optional<Level> getIndexRelation(const StratifiedSets<Value *> &Sets,
+                                        StratifiedIndex Index1,
+                                        StratifiedIndex Index2) {
+  if (Index1 == Index2)
+    return Level::Same;
+
+  const auto *Current = &Sets.getLink(Index1);
+  while (Current->hasBelow()) {
+    if (Current->Below == Index2)
+      return Level::Below;
+    Current = &Sets.getLink(Current->Below);
+  }
+
+  Current = &Sets.getLink(Index1);
+  while (Current->hasAbove()) {
+    if (Current->Above == Index2)
+      return Level::Above;
+    Current = &Sets.getLink(Current->Above);
+  }
+
+  return NoneType();
+}
+
+void CFLAAResult::FunctionInfo::summarize(Function &Fn) {
+  SmallVector<StratifiedInfo, 8> Parameters;
+  for (auto &Param : Fn.args()) {
+    auto MaybeInfo = Sets.find(&Param);
+    // Did a new parameter somehow get added to the function/slip by?
+    if (!MaybeInfo.hasValue())
+      return;
+    Parameters.push_back(*MaybeInfo);
+  }
+
+  SmallVector<StratifiedInfo, 4> Returns;
+  for (auto *RetVal : ReturnedValues) {
+    auto MaybeInfo = Sets.find(RetVal);
+    if (!MaybeInfo.hasValue())
+      return;
+    Returns.push_back(*MaybeInfo);
+  }
+
+  InterfaceSummary NewSummary;
+  NewSummary.NumParams = Parameters.size();
+  for (unsigned I = 0, E = Parameters.size(); I != E; ++I) {
+    auto &ParamInfo = Parameters[I];
+    for (auto &RetInfo : Returns) {
+      if (getIndexRelation(Sets, ParamInfo.Index, RetInfo.Index).hasValue()) {
+        NewSummary.RetAliasingParams.push_back(I);
+        break;
+      }
+    }
+  }
+
+  for (unsigned I = 0, E = Parameters.size(); I != E; ++I) {
+    auto &MainInfo = Parameters[I];
+    auto &MainAttrs = Sets.getLink(MainInfo.Index).Attrs;
+    for (unsigned X = I + 1; X != E; ++X) {
+      auto &SubInfo = Parameters[X];
+      auto &SubAttrs = Sets.getLink(SubInfo.Index).Attrs;
+      if (!getIndexRelation(Sets, MainInfo.Index, SubInfo.Index).hasValue())
+        continue;
+
+      NewSummary.ParamRelations.push_back(
+          ParamRelation(I, X, SubAttrs | MainAttrs));
+    }
+  }
+
+  Summary = std::move(NewSummary);
+}
+
 // Builds the graph + StratifiedSets for a function.
 CFLAAResult::FunctionInfo CFLAAResult::buildSetsFrom(Function *Fn) {
   NodeMapT Map;
@@ -986,7 +1011,12 @@ CFLAAResult::FunctionInfo CFLAAResult::buildSetsFrom(Function *Fn) {
       Builder.noteAttributes(&Arg, *Attrs);
   }
 
-  return FunctionInfo(Builder.build(), std::move(ReturnedValues));
+  FunctionInfo Info(Builder.build(), std::move(ReturnedValues));
+  // Only functions with local linkage are ever candidates for
+  // interprocedural analysis, so don't bother summarizing anything else.
+  if (!GetEdgesVisitor::isFunctionExternal(Fn) && !Fn->isVarArg())
+    Info.summarize(*Fn);
+  return Info;
 }
 
 void CFLAAResult::scan(Function *Fn) {
@@ -17,6 +17,7 @@
 
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/Function.h"
@@ -98,9 +99,11 @@ private:
   
   bool RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
                     CallGraph &CG, bool &CallGraphUpToDate,
+                    SmallPtrSetImpl<Function *> &DirtyFunctions,
                     bool &DevirtualizedCall);
   bool RefreshCallGraph(CallGraphSCC &CurSCC, CallGraph &CG,
-                        bool IsCheckingMode);
+                        bool IsCheckingMode,
+                        SmallPtrSetImpl<Function *> *DirtyFunctions = nullptr);
 };
 
 } // end anonymous namespace.
@@ -110,6 +113,7 @@ char CGPassManager::ID = 0;
 
 bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
                                  CallGraph &CG, bool &CallGraphUpToDate,
+                                 SmallPtrSetImpl<Function *> &DirtyFunctions,
                                  bool &DevirtualizedCall) {
   bool Changed = false;
   PMDataManager *PM = P->getAsPMDataManager();
@@ -117,7 +121,8 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
   if (!PM) {
     CallGraphSCCPass *CGSP = (CallGraphSCCPass*)P;
     if (!CallGraphUpToDate) {
-      DevirtualizedCall |= RefreshCallGraph(CurSCC, CG, false);
+      DevirtualizedCall |=
+          RefreshCallGraph(CurSCC, CG, false, &DirtyFunctions);
       CallGraphUpToDate = true;
     }
 
@@ -145,11 +150,20 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
   for (CallGraphNode *CGN : CurSCC) {
     if (Function *F = CGN->getFunction()) {
       dumpPassInfo(P, EXECUTION_MSG, ON_FUNCTION_MSG, F->getName());
+      bool FunctionChanged;
       {
         TimeRegion PassTimer(getPassTimer(FPP));
-        Changed |= FPP->runOnFunction(*F);
+        FunctionChanged = FPP->runOnFunction(*F);
       }
       F->getContext().yield();
+
+      // Function passes only touch the function they run on, so only the
+      // functions they changed need to be rescanned when refreshing the
+      // callgraph.
+      if (FunctionChanged) {
+        DirtyFunctions.insert(F);
+        Changed = true;
+      }
     }
   }
   
@@ -169,13 +183,18 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 /// FunctionPasses have potentially munged the callgraph, and can be used after
 /// CallGraphSCC passes to verify that they correctly updated the callgraph.
 ///
+/// If DirtyFunctions is non-null, only the functions in it are rescanned, as
+/// all others are known to be unchanged since the last refresh.  The set is
+/// cleared on return.
+///
 /// This function returns true if it devirtualized an existing function call,
 /// meaning it turned an indirect call into a direct call.  This happens when
 /// a function pass like GVN optimizes away stuff feeding the indirect call.
 /// This never happens in checking mode.
 ///
-bool CGPassManager::RefreshCallGraph(CallGraphSCC &CurSCC,
-                                     CallGraph &CG, bool CheckingMode) {
+bool CGPassManager::RefreshCallGraph(
+    CallGraphSCC &CurSCC, CallGraph &CG, bool CheckingMode,
+    SmallPtrSetImpl<Function *> *DirtyFunctions) {
   DenseMap<Value*, CallGraphNode*> CallSites;
   
   DEBUG(dbgs() << "CGSCCPASSMGR: Refreshing SCC with " << CurSCC.size()
@@ -194,6 +213,13 @@ bool CGPassManager::RefreshCallGraph(CallGraphSCC &CurSCC,
     CallGraphNode *CGN = *SCCIdx;
     Function *F = CGN->getFunction();
     if (!F || F->isDeclaration()) continue;
+
+    // Skip functions which haven't been touched since the last refresh.
+    if (DirtyFunctions && !DirtyFunctions->count(F)) {
+      DEBUG(dbgs() << "  CGSCCPASSMGR: Skipping unchanged function '"
+                   << F->getName() << "'\n");
+      continue;
+    }
     
     // Walk the function body looking for call sites.  Sync up the call sites in
     // CGN with those actually in the function.
@@ -371,6 +397,8 @@ bool CGPassManager::RefreshCallGraph(CallGraphSCC &CurSCC,
         );
   (void)MadeChange;
 
+  if (DirtyFunctions)
+    DirtyFunctions->clear();
   return DevirtualizedCall;
 }
 
@@ -390,6 +418,10 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
   // the callgraph when we need to run a CGSCCPass again.
   bool CallGraphUpToDate = true;
 
+  // The functions changed by function passes since the callgraph was last
+  // known to be up-to-date.
+  SmallPtrSet<Function *, 8> DirtyFunctions;
+
   // Run all passes on current SCC.
   for (unsigned PassNo = 0, e = getNumContainedPasses();
        PassNo != e; ++PassNo) {
@@ -415,8 +447,8 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
     initializeAnalysisImpl(P);
     
     // Actually run this pass on the current SCC.
-    Changed |= RunPassOnSCC(P, CurSCC, CG,
-                            CallGraphUpToDate, DevirtualizedCall);
+    Changed |= RunPassOnSCC(P, CurSCC, CG, CallGraphUpToDate, DirtyFunctions,
+                            DevirtualizedCall);
     
     if (Changed)
       dumpPassInfo(P, MODIFICATION_MSG, ON_CG_MSG, "");
@@ -431,7 +463,7 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
   // If the callgraph was left out of date (because the last pass run was a
   // functionpass), refresh it before we move on to the next SCC.
   if (!CallGraphUpToDate)
-    DevirtualizedCall |= RefreshCallGraph(CurSCC, CG, false);
+    DevirtualizedCall |= RefreshCallGraph(CurSCC, CG, false, &DirtyFunctions);
   return Changed;
 }
 
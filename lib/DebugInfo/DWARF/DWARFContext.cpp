@@ -17,6 +17,7 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 using namespace llvm;
@@ -421,6 +422,40 @@ void DWARFContext::parseDWOTypeUnits() {
   }
 }
 
+void DWARFContext::extractAllDIEs(unsigned NumThreads) {
+  // Parsing the unit headers fills in the unit sections, so it has to happen
+  // before the threads start. Each unit's DIEs are only touched by the thread
+  // that extracts them.
+  std::vector<DWARFUnit *> Units;
+  for (const auto &CU : compile_units())
+    Units.push_back(CU.get());
+  for (const auto &TUS : type_unit_sections())
+    for (const auto &TU : TUS)
+      Units.push_back(TU.get());
+  for (const auto &CU : dwo_compile_units())
+    Units.push_back(CU.get());
+  for (const auto &TUS : dwo_type_unit_sections())
+    for (const auto &TU : TUS)
+      Units.push_back(TU.get());
+
+  if (NumThreads <= 1 || Units.size() < 2) {
+    for (DWARFUnit *U : Units)
+      U->getUnitDIE(false);
+    return;
+  }
+
+  // Start with the largest units so that a big unit is not left running
+  // alone at the end.
+  std::stable_sort(Units.begin(), Units.end(),
+                   [](const DWARFUnit *L, const DWARFUnit *R) {
+    return L->getLength() > R->getLength();
+  });
+  ThreadPool Pool(NumThreads);
+  for (DWARFUnit *U : Units)
+    Pool.async([U] { U->getUnitDIE(false); });
+  Pool.wait();
+}
+
 DWARFCompileUnit *DWARFContext::getCompileUnitForOffset(uint32_t Offset) {
   parseCompileUnits();
   return CUs.getUnitForOffset(Offset);
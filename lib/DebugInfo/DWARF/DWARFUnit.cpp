@@ -12,7 +12,9 @@
 #include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <cstdio>
+#include <queue>
 
 namespace llvm {
 using namespace dwarf;
@@ -136,6 +138,8 @@ void DWARFUnit::clear() {
   RangeSectionBase = 0;
   AddrOffsetSectionBase = 0;
   clearDIEs(false);
+  SubprogramAddrMap.clear();
+  SubprogramAddrMapBuilt = false;
   DWO.reset();
 }
 
@@ -246,6 +250,12 @@ size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
   if (DieArray.empty())
     return 0;
 
+  // extractDIEsToVector() reserves room for DIEs based on the average DIE
+  // size, which overshoots for units with large DIEs. The array lives as long
+  // as the unit does, so give back the slack when it is significant.
+  if (!CUDieOnly && DieArray.capacity() - DieArray.size() > DieArray.size() / 8)
+    DieArray.shrink_to_fit();
+
   // If CU DIE was just parsed, copy several attribute values from it.
   if (!HasCUDie) {
     uint64_t BaseAddr =
@@ -358,16 +368,75 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
     clearDIEs(true);
 }
 
+void DWARFUnit::buildSubprogramAddrMap() {
+  std::vector<SubprogramRange> Ranges;
+  std::vector<uint64_t> Bounds;
+  for (uint32_t I = 0, E = DieArray.size(); I != E; ++I) {
+    const DWARFDebugInfoEntryMinimal &DIE = DieArray[I];
+    if (!DIE.isSubprogramDIE())
+      continue;
+    for (const auto &R : DIE.getAddressRanges(this)) {
+      if (R.first >= R.second)
+        continue;
+      Ranges.push_back({R.first, R.second, I});
+      Bounds.push_back(R.first);
+      Bounds.push_back(R.second);
+    }
+  }
+  std::sort(Ranges.begin(), Ranges.end(),
+            [](const SubprogramRange &LHS, const SubprogramRange &RHS) {
+              return LHS.LowPC < RHS.LowPC;
+            });
+  std::sort(Bounds.begin(), Bounds.end());
+  Bounds.erase(std::unique(Bounds.begin(), Bounds.end()), Bounds.end());
+
+  // Sweep over the range boundaries. Where subprogram ranges overlap, the
+  // interval goes to the subprogram that comes first in the DIE array, which
+  // is the one a linear scan of the DIEs would find. For nested subprograms
+  // that is the outermost one; getInlinedChainForAddress walks down from it
+  // to the innermost.
+  typedef std::pair<uint32_t, uint64_t> ActiveRange; // DIE index, HighPC.
+  std::priority_queue<ActiveRange, std::vector<ActiveRange>,
+                      std::greater<ActiveRange>> Active;
+  size_t Next = 0;
+  for (size_t B = 0; B + 1 < Bounds.size(); ++B) {
+    uint64_t LowPC = Bounds[B], HighPC = Bounds[B + 1];
+    for (; Next != Ranges.size() && Ranges[Next].LowPC == LowPC; ++Next)
+      Active.push(std::make_pair(Ranges[Next].DieIndex, Ranges[Next].HighPC));
+    while (!Active.empty() && Active.top().second <= LowPC)
+      Active.pop();
+    if (Active.empty())
+      continue;
+    uint32_t DieIndex = Active.top().first;
+    if (!SubprogramAddrMap.empty() &&
+        SubprogramAddrMap.back().HighPC == LowPC &&
+        SubprogramAddrMap.back().DieIndex == DieIndex)
+      SubprogramAddrMap.back().HighPC = HighPC;
+    else
+      SubprogramAddrMap.push_back({LowPC, HighPC, DieIndex});
+  }
+  SubprogramAddrMapBuilt = true;
+}
+
 const DWARFDebugInfoEntryMinimal *
 DWARFUnit::getSubprogramForAddress(uint64_t Address) {
   extractDIEsIfNeeded(false);
-  for (const DWARFDebugInfoEntryMinimal &DIE : DieArray) {
-    if (DIE.isSubprogramDIE() &&
-        DIE.addressRangeContainsAddress(this, Address)) {
-      return &DIE;
-    }
-  }
-  return nullptr;
+  // The map refers to DIEs by index, which stays valid if the DIEs are
+  // cleared and extracted again.
+  if (!SubprogramAddrMapBuilt)
+    buildSubprogramAddrMap();
+
+  auto It = std::upper_bound(
+      SubprogramAddrMap.begin(), SubprogramAddrMap.end(), Address,
+      [](uint64_t Address, const SubprogramRange &R) {
+        return Address < R.LowPC;
+      });
+  if (It == SubprogramAddrMap.begin())
+    return nullptr;
+  --It;
+  if (Address >= It->HighPC)
+    return nullptr;
+  return &DieArray[It->DieIndex];
 }
 
 DWARFDebugInfoEntryInlinedChain
@@ -29,8 +29,12 @@
 #include "llvm/Support/DataExtractor.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
 #include <stdlib.h>
 
 #if defined(_MSC_VER)
@@ -42,6 +46,10 @@
 #ifdef IMAGE_FILE_MACHINE_I386
 #undef IMAGE_FILE_MACHINE_I386
 #endif
+
+// DbgHelp functions are not thread-safe, and batches are demangled on
+// several threads.
+static llvm::ManagedStatic<llvm::sys::Mutex> DbgHelpMutex;
 #endif
 
 namespace llvm {
@@ -52,8 +60,28 @@ ErrorOr<DILineInfo> LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
   auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
   if (auto EC = InfoOrErr.getError())
     return EC;
-  SymbolizableModule *Info = InfoOrErr.get();
+  return symbolizeCode(InfoOrErr.get(), ModuleOffset);
+}
+
+ErrorOr<DIInliningInfo>
+LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
+                                     uint64_t ModuleOffset) {
+  auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
+  if (auto EC = InfoOrErr.getError())
+    return EC;
+  return symbolizeInlinedCode(InfoOrErr.get(), ModuleOffset);
+}
+
+ErrorOr<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
+                                                uint64_t ModuleOffset) {
+  auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
+  if (auto EC = InfoOrErr.getError())
+    return EC;
+  return symbolizeData(InfoOrErr.get(), ModuleOffset);
+}
 
+DILineInfo LLVMSymbolizer::symbolizeCode(SymbolizableModule *Info,
+                                         uint64_t ModuleOffset) {
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
   if (Opts.RelativeAddresses)
@@ -66,14 +94,8 @@ ErrorOr<DILineInfo> LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
   return LineInfo;
 }
 
-ErrorOr<DIInliningInfo>
-LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
-                                     uint64_t ModuleOffset) {
-  auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
-  if (auto EC = InfoOrErr.getError())
-    return EC;
-  SymbolizableModule *Info = InfoOrErr.get();
-
+DIInliningInfo LLVMSymbolizer::symbolizeInlinedCode(SymbolizableModule *Info,
+                                                    uint64_t ModuleOffset) {
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
   if (Opts.RelativeAddresses)
@@ -90,13 +112,8 @@ LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
   return InlinedContext;
 }
 
-ErrorOr<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
-                                                uint64_t ModuleOffset) {
-  auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
-  if (auto EC = InfoOrErr.getError())
-    return EC;
-  SymbolizableModule *Info = InfoOrErr.get();
-
+DIGlobal LLVMSymbolizer::symbolizeData(SymbolizableModule *Info,
+                                       uint64_t ModuleOffset) {
   // If the user is giving us relative addresses, add the preferred base of
   // the object to the offset before we do the query. It's what DIContext
   // expects.
@@ -109,6 +126,106 @@ ErrorOr<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
   return Global;
 }
 
+void LLVMSymbolizer::symbolizeRequest(SymbolizableModule *Info,
+                                      const BatchRequest &Request,
+                                      BatchResult &Result) {
+  switch (Request.Kind) {
+  case BatchRequest::Code:
+    Result.LineInfo = symbolizeCode(Info, Request.ModuleOffset);
+    break;
+  case BatchRequest::InlinedCode:
+    Result.InliningInfo = symbolizeInlinedCode(Info, Request.ModuleOffset);
+    break;
+  case BatchRequest::Data:
+    Result.Global = symbolizeData(Info, Request.ModuleOffset);
+    break;
+  }
+}
+
+// A module with fewer requests than this is symbolized by a single thread;
+// past it, each additional thread parses its own copy of the module's debug
+// info, which only pays off for a large number of addresses.
+static const size_t MinRequestsPerModuleCopy = 1 << 14;
+
+std::vector<LLVMSymbolizer::BatchResult>
+LLVMSymbolizer::symbolizeBatch(ArrayRef<BatchRequest> Requests,
+                               unsigned NumThreads) {
+  assert(NumThreads > 0 && "Need at least one thread");
+  std::vector<BatchResult> Results(Requests.size());
+
+  // Visit the requests grouped by module, in address order within a module,
+  // so that consecutive queries hit the same compile units and line tables.
+  std::vector<size_t> Order(Requests.size());
+  for (size_t I = 0, E = Order.size(); I != E; ++I)
+    Order[I] = I;
+  std::sort(Order.begin(), Order.end(), [&](size_t L, size_t R) {
+    const BatchRequest &A = Requests[L], &B = Requests[R];
+    if (A.ModuleName != B.ModuleName)
+      return A.ModuleName < B.ModuleName;
+    return A.ModuleOffset < B.ModuleOffset;
+  });
+
+  // Symbolize the requests Order[Begin, End), all against the same module. The
+  // first range of a module uses the cached module; the others build a private
+  // copy, as a module cannot be queried from two threads at once.
+  auto SymbolizeRange = [&](size_t Begin, size_t End, bool UseCached) {
+    std::string ModuleName = Requests[Order[Begin]].ModuleName;
+    SymbolizableModule *Info = nullptr;
+    std::unique_ptr<SymbolizableModule> PrivateInfo;
+    std::error_code EC;
+    if (UseCached) {
+      auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
+      if (!(EC = InfoOrErr.getError()))
+        Info = InfoOrErr.get();
+    } else {
+      auto InfoOrErr = createModuleInfo(ModuleName);
+      if (!(EC = InfoOrErr.getError())) {
+        PrivateInfo = std::move(InfoOrErr.get());
+        Info = PrivateInfo.get();
+      }
+    }
+    for (size_t I = Begin; I != End; ++I) {
+      if (EC)
+        Results[Order[I]].EC = EC;
+      else
+        symbolizeRequest(Info, Requests[Order[I]], Results[Order[I]]);
+    }
+  };
+
+  if (NumThreads == 1) {
+    for (size_t Begin = 0, E = Order.size(); Begin != E;) {
+      size_t End = Begin + 1;
+      while (End != E &&
+             Requests[Order[End]].ModuleName == Requests[Order[Begin]].ModuleName)
+        ++End;
+      SymbolizeRange(Begin, End, /*UseCached=*/true);
+      Begin = End;
+    }
+    return Results;
+  }
+
+  ThreadPool Pool(NumThreads);
+  for (size_t Begin = 0, E = Order.size(); Begin != E;) {
+    size_t End = Begin + 1;
+    while (End != E &&
+           Requests[Order[End]].ModuleName == Requests[Order[Begin]].ModuleName)
+      ++End;
+
+    // Split large modules into contiguous address ranges, one per thread.
+    size_t NumRequests = End - Begin;
+    size_t NumRanges = std::min<size_t>(
+        NumThreads, std::max<size_t>(1, NumRequests / MinRequestsPerModuleCopy));
+    size_t RangeSize = (NumRequests + NumRanges - 1) / NumRanges;
+    for (size_t RangeBegin = Begin; RangeBegin < End; RangeBegin += RangeSize)
+      Pool.async(SymbolizeRange, RangeBegin,
+                 std::min(RangeBegin + RangeSize, End),
+                 /*UseCached=*/RangeBegin == Begin);
+    Begin = End;
+  }
+  Pool.wait();
+  return Results;
+}
+
 void LLVMSymbolizer::flush() {
   ObjectForUBPathAndArch.clear();
   BinaryForPath.clear();
@@ -333,13 +450,32 @@ LLVMSymbolizer::getOrCreateObject(const std::string &Path,
 
 ErrorOr<SymbolizableModule *>
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
-  const auto &I = Modules.find(ModuleName);
-  if (I != Modules.end()) {
-    auto &InfoOrErr = I->second;
-    if (auto EC = InfoOrErr.getError())
-      return EC;
-    return InfoOrErr->get();
+  {
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+    const auto &I = Modules.find(ModuleName);
+    if (I != Modules.end()) {
+      auto &InfoOrErr = I->second;
+      if (auto EC = InfoOrErr.getError())
+        return EC;
+      return InfoOrErr->get();
+    }
   }
+
+  // Parse the module without holding the lock, so that other modules can be
+  // loaded meanwhile. If another thread cached the same module first, keep
+  // its copy.
+  auto InfoOrErr = createModuleInfo(ModuleName);
+
+  std::lock_guard<std::mutex> Lock(CacheMutex);
+  auto InsertResult =
+      Modules.insert(std::make_pair(ModuleName, std::move(InfoOrErr)));
+  if (auto EC = InsertResult.first->second.getError())
+    return EC;
+  return InsertResult.first->second->get();
+}
+
+ErrorOr<std::unique_ptr<SymbolizableModule>>
+LLVMSymbolizer::createModuleInfo(const std::string &ModuleName) {
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
   size_t ColonPos = ModuleName.find_last_of(':');
@@ -351,12 +487,12 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       ArchName = ArchStr;
     }
   }
+  std::unique_lock<std::mutex> Lock(CacheMutex);
   auto ObjectsOrErr = getOrCreateObjectPair(BinaryName, ArchName);
-  if (auto EC = ObjectsOrErr.getError()) {
-    // Failed to find valid object file.
-    Modules.insert(std::make_pair(ModuleName, EC));
+  Lock.unlock();
+  // Failed to find valid object file.
+  if (auto EC = ObjectsOrErr.getError())
     return EC;
-  }
   ObjectPair Objects = ObjectsOrErr.get();
 
   std::unique_ptr<DIContext> Context;
@@ -373,14 +509,7 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   if (!Context)
     Context.reset(new DWARFContextInMemory(*Objects.second));
   assert(Context);
-  auto InfoOrErr =
-      SymbolizableObjectFile::create(Objects.first, std::move(Context));
-  auto InsertResult =
-      Modules.insert(std::make_pair(ModuleName, std::move(InfoOrErr)));
-  assert(InsertResult.second);
-  if (auto EC = InsertResult.first->second.getError())
-    return EC;
-  return InsertResult.first->second->get();
+  return SymbolizableObjectFile::create(Objects.first, std::move(Context));
 }
 
 // Undo these various manglings for Win32 extern "C" functions:
@@ -436,6 +565,7 @@ std::string LLVMSymbolizer::DemangleName(const std::string &Name,
   if (!Name.empty() && Name.front() == '?') {
     // Only do MSVC C++ demangling on symbols starting with '?'.
     char DemangledName[1024] = {0};
+    sys::ScopedLock Lock(*DbgHelpMutex);
     DWORD result = ::UnDecorateSymbolName(
         Name.c_str(), DemangledName, 1023,
         UNDNAME_NO_ACCESS_SPECIFIERS |       // Strip public, private, protected
@@ -10,15 +10,29 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/MutexGuard.h"
+#include <vector>
 
 using namespace llvm;
 using namespace llvm::object;
 
+static cl::opt<bool> DeferRegistration(
+    "jit-debug-defer-registration", cl::init(false),
+    cl::desc("Queue the debug objects of JIT'd code instead of announcing "
+             "each one to the debugger as it is emitted. Queued objects are "
+             "announced by calling __llvm_jit_debug_register_deferred(), "
+             "e.g. from an attached debugger"));
+
+static cl::opt<unsigned> RegistrationBatchSize(
+    "jit-debug-registration-batch", cl::init(0),
+    cl::desc("With -jit-debug-defer-registration, register the queued "
+             "objects once this many are pending (0: only on request)"));
+
 // This must be kept in sync with gdb/gdb/jit.h .
 extern "C" {
 
@@ -94,9 +108,16 @@ typedef llvm::DenseMap< const char*, RegisteredObjectInfo>
 /// class.
 class GDBJITRegistrationListener : public JITEventListener {
   /// A map of in-memory object files that have been registered with the
-  /// JIT interface.
+  /// JIT interface. With -jit-debug-defer-registration, an object's debug copy
+  /// is made when it is emitted but its Entry stays null until it is
+  /// announced to the debugger.
   RegisteredObjectBufferMap ObjectBufferMap;
 
+  /// Keys of the objects in ObjectBufferMap that have not been announced yet,
+  /// in the order they were emitted. Keys of objects freed in the meantime
+  /// are skipped.
+  std::vector<const char *> DeferredKeys;
+
 public:
   /// Instantiates the JIT service.
   GDBJITRegistrationListener() : ObjectBufferMap() {}
@@ -116,7 +137,15 @@ public:
   /// Returns true if @p Object was found in ObjectBufferMap.
   void NotifyFreeingObject(const ObjectFile &Object) override;
 
+  /// Announces every deferred object to the debugger. JITDebugLock must be
+  /// held.
+  void registerDeferredObjects();
+
 private:
+  /// Links the entry for the registered object @p Info into the debugger's
+  /// list and notifies the debugger. JITDebugLock must be held.
+  void registerObjectInternal(RegisteredObjectInfo &Info);
+
   /// Deregister the debug info for the given object file from the debugger
   /// and delete any temporary copies.  This private method does not remove
   /// the function from Map so that it can be called while iterating over Map.
@@ -154,38 +183,64 @@ GDBJITRegistrationListener::~GDBJITRegistrationListener() {
     deregisterObjectInternal(I);
   }
   ObjectBufferMap.clear();
+  DeferredKeys.clear();
 }
 
 void GDBJITRegistrationListener::NotifyObjectEmitted(
                                        const ObjectFile &Object,
                                        const RuntimeDyld::LoadedObjectInfo &L) {
+  const char *Key = Object.getMemoryBufferRef().getBufferStart();
+  assert(Key && "Attempt to register a null object with a debugger.");
 
+  // The debug copy is always made here: the load information refers to the
+  // RuntimeDyld instance, which need not outlive this call (Orc's
+  // ObjectLinkingLayer destroys it once the object is finalized).
   OwningBinary<ObjectFile> DebugObj = L.getObjectForDebug(Object);
 
   // Bail out if debug objects aren't supported.
   if (!DebugObj.getBinary())
     return;
 
-  const char *Buffer = DebugObj.getBinary()->getMemoryBufferRef().getBufferStart();
-  size_t      Size = DebugObj.getBinary()->getMemoryBufferRef().getBufferSize();
-
-  const char *Key = Object.getMemoryBufferRef().getBufferStart();
-
-  assert(Key && "Attempt to register a null object with a debugger.");
+  size_t Size = DebugObj.getBinary()->getMemoryBufferRef().getBufferSize();
   llvm::MutexGuard locked(*JITDebugLock);
   assert(ObjectBufferMap.find(Key) == ObjectBufferMap.end() &&
          "Second attempt to perform debug registration.");
+  RegisteredObjectInfo &Info = ObjectBufferMap[Key];
+  Info = RegisteredObjectInfo(Size, nullptr, std::move(DebugObj));
+
+  if (!DeferRegistration) {
+    registerObjectInternal(Info);
+    return;
+  }
+
+  DeferredKeys.push_back(Key);
+  if (RegistrationBatchSize && DeferredKeys.size() >= RegistrationBatchSize)
+    registerDeferredObjects();
+}
+
+void GDBJITRegistrationListener::registerDeferredObjects() {
+  for (const char *Key : DeferredKeys) {
+    RegisteredObjectBufferMap::iterator I = ObjectBufferMap.find(Key);
+    if (I != ObjectBufferMap.end() && !I->second.Entry)
+      registerObjectInternal(I->second);
+  }
+  DeferredKeys.clear();
+}
+
+void GDBJITRegistrationListener::registerObjectInternal(
+    RegisteredObjectInfo &Info) {
+  assert(!Info.Entry && "Second attempt to perform debug registration.");
   jit_code_entry* JITCodeEntry = new jit_code_entry();
 
   if (!JITCodeEntry) {
     llvm::report_fatal_error(
       "Allocation failed when registering a JIT entry!\n");
   } else {
-    JITCodeEntry->symfile_addr = Buffer;
-    JITCodeEntry->symfile_size = Size;
+    JITCodeEntry->symfile_addr =
+        Info.Obj.getBinary()->getMemoryBufferRef().getBufferStart();
+    JITCodeEntry->symfile_size = Info.Size;
 
-    ObjectBufferMap[Key] = RegisteredObjectInfo(Size, JITCodeEntry,
-                                                std::move(DebugObj));
+    Info.Entry = JITCodeEntry;
     NotifyDebugger(JITCodeEntry);
   }
 }
@@ -206,6 +261,10 @@ void GDBJITRegistrationListener::deregisterObjectInternal(
 
   jit_code_entry*& JITCodeEntry = I->second.Entry;
 
+  // Objects that are still deferred were never announced.
+  if (!JITCodeEntry)
+    return;
+
   // Do the unregistration.
   {
     __jit_debug_descriptor.action_flag = JIT_UNREGISTER_FN;
@@ -245,3 +304,16 @@ JITEventListener* JITEventListener::createGDBRegistrationListener() {
 }
 
 } // namespace llvm
+
+/// Registers the objects queued by -jit-debug-defer-registration. Intended to
+/// be called on demand, e.g. by a debugger after attaching
+/// ("call __llvm_jit_debug_register_deferred()") or by the host application.
+/// A debugger calls this while the rest of the program is stopped, possibly
+/// with another thread holding the registration lock, so this returns without
+/// registering anything rather than wait for the lock.
+extern "C" LLVM_ATTRIBUTE_USED void __llvm_jit_debug_register_deferred() {
+  if (!GDBRegListener.isConstructed() || !JITDebugLock->try_lock())
+    return;
+  GDBRegListener->registerDeferredObjects();
+  JITDebugLock->unlock();
+}
@@ -40,7 +40,7 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //===----------------------------------------------------------------------===//
 
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  SF.getValue(V) = Val;
 }
 
 //===----------------------------------------------------------------------===//
@@ -1091,7 +1091,10 @@ void Interpreter::visitCallSite(CallSite CS) {
       bool atBegin(Parent->begin() == me);
       if (!atBegin)
         --me;
+      ValueSlotMap &Slots = getValueSlots(*Parent->getParent());
+      Slots.Slots.erase(CS.getInstruction());
       IL->LowerIntrinsicCall(cast<CallInst>(CS.getInstruction()));
+      addInstructionSlots(*Parent->getParent(), Slots);
 
       // Restore the CurInst pointer to the first instruction newly inserted, if
       // any.
@@ -2062,7 +2065,7 @@ GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
   } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
     return PTOGV(getPointerToGlobal(GV));
   } else {
-    return SF.Values[V];
+    return SF.getValue(V);
   }
 }
 
@@ -2070,6 +2073,38 @@ GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
 //                        Dispatch and Execution Code
 //===----------------------------------------------------------------------===//
 
+// getValueSlots - Number F's arguments and the instructions producing values
+// the first time F is called, so that its stack frames can hold their values
+// in a vector rather than a map keyed by Value.
+//
+ValueSlotMap &Interpreter::getValueSlots(Function &F) {
+  std::unique_ptr<ValueSlotMap> &Slots = FunctionSlots[&F];
+  if (!Slots) {
+    Slots = llvm::make_unique<ValueSlotMap>();
+    for (Argument &A : F.args())
+      Slots->Slots.insert(std::make_pair(&A, Slots->NumSlots++));
+    addInstructionSlots(F, *Slots);
+  }
+  return *Slots;
+}
+
+// addInstructionSlots - Give a slot to each instruction of F producing a value
+// that doesn't have one yet, and grow the frames executing F to match. This
+// runs when F is first numbered and again whenever lowering an intrinsic call
+// inserts new instructions into it. Slots are never reused: an erased
+// instruction's slot is simply left idle.
+//
+void Interpreter::addInstructionSlots(Function &F, ValueSlotMap &Slots) {
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      if (!I.getType()->isVoidTy() &&
+          Slots.Slots.insert(std::make_pair(&I, Slots.NumSlots)).second)
+        ++Slots.NumSlots;
+  for (ExecutionContext &SF : ECStack)
+    if (SF.Slots == &Slots)
+      SF.Values.resize(Slots.NumSlots);
+}
+
 //===----------------------------------------------------------------------===//
 // callFunction - Execute the specified function...
 //
@@ -2094,6 +2129,10 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
   StackFrame.CurBB     = &F->front();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
 
+  // Set up the slots for the function's values.
+  StackFrame.Slots = &getValueSlots(*F);
+  StackFrame.Values.resize(StackFrame.Slots->NumSlots);
+
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
          (ArgVals.size() > F->arg_size() && F->getFunctionType()->isVarArg()))&&
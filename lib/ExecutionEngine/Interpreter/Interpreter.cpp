@@ -64,6 +64,14 @@ Interpreter::~Interpreter() {
   delete IL;
 }
 
+bool Interpreter::removeModule(Module *M) {
+  if (!ExecutionEngine::removeModule(M))
+    return false;
+  for (Function &F : *M)
+    FunctionSlots.erase(&F);
+  return true;
+}
+
 void Interpreter::runAtExitHandlers () {
   while (!AtExitHandlers.empty()) {
     callFunction(AtExitHandlers.back(), None);
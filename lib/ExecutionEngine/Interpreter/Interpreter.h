@@ -14,12 +14,14 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 #define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/ValueMap.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -58,6 +60,16 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// Dense numbering of the arguments and instructions of a function. Stack
+// frames keep their values in a vector of NumSlots entries indexed by these
+// slots.
+struct ValueSlotMap {
+  DenseMap<const Value *, unsigned> Slots;
+  unsigned NumSlots;
+
+  ValueSlotMap() : NumSlots(0) {}
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
@@ -67,15 +79,18 @@ struct ExecutionContext {
   BasicBlock::iterator  CurInst;    // The next instruction to execute
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  const ValueSlotMap   *Slots;      // Slot numbers for CurFunction's values
+  ValuePlaneTy         Values;     // LLVM values used in this invocation
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   AllocaHolder Allocas;            // Track memory allocated by alloca
 
-  ExecutionContext() : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr) {}
+  ExecutionContext()
+      : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr),
+        Slots(nullptr) {}
 
   ExecutionContext(ExecutionContext &&O)
       : CurFunction(O.CurFunction), CurBB(O.CurBB), CurInst(O.CurInst),
-        Caller(O.Caller), Values(std::move(O.Values)),
+        Caller(O.Caller), Slots(O.Slots), Values(std::move(O.Values)),
         VarArgs(std::move(O.VarArgs)), Allocas(std::move(O.Allocas)) {}
 
   ExecutionContext &operator=(ExecutionContext &&O) {
@@ -83,11 +98,22 @@ struct ExecutionContext {
     CurBB = O.CurBB;
     CurInst = O.CurInst;
     Caller = O.Caller;
+    Slots = O.Slots;
     Values = std::move(O.Values);
     VarArgs = std::move(O.VarArgs);
     Allocas = std::move(O.Allocas);
     return *this;
   }
+
+  /// Return the value V has in this invocation. Every argument and
+  /// value-producing instruction of CurFunction has a slot by the time it is
+  /// read or written, so this never changes Slots or resizes Values.
+  GenericValue &getValue(const Value *V) {
+    auto I = Slots->Slots.find(V);
+    assert(I != Slots->Slots.end() && I->second < Values.size() &&
+           "Value has no slot in this stack frame!");
+    return Values[I->second];
+  }
 };
 
 // Interpreter - This class represents the entirety of the interpreter.
@@ -104,6 +130,15 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // Slot numberings for the functions that have been called so far. Entries
+  // go away with their function, and are not carried over on RAUW since the
+  // replacement has a different body.
+  struct FunctionSlotsConfig : ValueMapConfig<const Function *> {
+    enum { FollowRAUW = false };
+  };
+  ValueMap<const Function *, std::unique_ptr<ValueSlotMap>,
+           FunctionSlotsConfig> FunctionSlots;
+
 public:
   explicit Interpreter(std::unique_ptr<Module> M);
   ~Interpreter() override;
@@ -122,6 +157,11 @@ public:
   static ExecutionEngine *create(std::unique_ptr<Module> M,
                                  std::string *ErrorStr = nullptr);
 
+  /// removeModule - Forget the slot numberings of M's functions, since M may
+  /// be modified before being added back.
+  ///
+  bool removeModule(Module *M) override;
+
   /// run - Start execution with the specified function and arguments.
   ///
   GenericValue runFunction(Function *F,
@@ -213,6 +253,9 @@ private:  // Helper functions
   //
   void SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF);
 
+  ValueSlotMap &getValueSlots(Function &F);
+  void addInstructionSlots(Function &F, ValueSlotMap &Slots);
+
   void *getPointerToFunction(Function *F) override { return (void*)F; }
 
   void initializeExecutionEngine() { }
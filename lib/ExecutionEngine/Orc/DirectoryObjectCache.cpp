@@ -0,0 +1,100 @@
+//===------- DirectoryObjectCache.cpp - Persistent, content-keyed cache ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/DirectoryObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace llvm {
+namespace orc {
+
+DirectoryObjectCache::DirectoryObjectCache(std::string CacheDir,
+                                           std::string ConfigKey)
+    : CacheDir(std::move(CacheDir)), ConfigKey(std::move(ConfigKey)) {}
+
+std::string DirectoryObjectCache::getCachePath(const Module &M) {
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream BitcodeStream(Bitcode);
+    WriteBitcodeToFile(&M, BitcodeStream);
+  }
+
+  MD5 Hash;
+  Hash.update(ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(Bitcode.data()), Bitcode.size()));
+  // Separate the two so that moving bytes between them changes the key.
+  Hash.update(StringRef("\0", 1));
+  Hash.update(ConfigKey);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> HashStr;
+  MD5::stringifyResult(Result, HashStr);
+
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, HashStr + ".o");
+  return Path.str();
+}
+
+void DirectoryObjectCache::notifyObjectCompiled(const Module *M,
+                                                MemoryBufferRef Obj) {
+  std::string Path;
+  auto I = PendingPaths.find(M);
+  if (I != PendingPaths.end()) {
+    Path = std::move(I->second);
+    PendingPaths.erase(I);
+  } else
+    Path = getCachePath(*M);
+
+  if (sys::fs::create_directories(CacheDir))
+    return;
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // readers (e.g. other processes sharing the cache) never see a partially
+  // written object.
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(Path + ".tmp-%%%%%%", FD, TempPath))
+    return;
+  {
+    raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    Out.write(Obj.getBufferStart(), Obj.getBufferSize());
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath, Path))
+    sys::fs::remove(TempPath);
+}
+
+std::unique_ptr<MemoryBuffer>
+DirectoryObjectCache::getObject(const Module *M) {
+  std::string Path = getCachePath(*M);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+    MemoryBuffer::getFile(Path, -1, false);
+  if (!Buffer) {
+    // Remember the path: a miss is normally followed by a compile of M.
+    PendingPaths[M] = std::move(Path);
+    return nullptr;
+  }
+  // Hand back a copy rather than the (possibly mmapped) file itself so the
+  // cache file can be replaced or removed while the object is in use.
+  return MemoryBuffer::getMemBufferCopy((*Buffer)->getBuffer(), Path);
+}
+
+} // End namespace orc.
+} // End namespace llvm.
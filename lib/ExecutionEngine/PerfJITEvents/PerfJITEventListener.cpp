@@ -0,0 +1,351 @@
+//===-- PerfJITEventListener.cpp - Tell Linux perf about JITted code ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a JITEventListener object that describes JITted functions
+// to Linux perf. Two files are written:
+//
+//  * /tmp/perf-<pid>.map, the simple symbol map 'perf report' reads for
+//    anonymous executable memory, and
+//  * jit-<pid>.dump, in the jitdump format consumed by 'perf inject --jit',
+//    which carries a copy of the code bytes and the source line table of each
+//    function so that perf can annotate JITted code after the process exits.
+//
+// The jitdump file is written to $JITDUMPDIR if set, else to the system
+// temporary directory. Record with 'perf record -k 1' so that the sample
+// timestamps use the same clock as the jitdump records.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/DebugInfo/DIContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace llvm;
+using namespace llvm::object;
+
+#define DEBUG_TYPE "perf-jit-event-listener"
+
+namespace {
+
+// Layout of the jitdump file, version 1. All fields are in host byte order.
+namespace jitdump {
+
+enum : uint32_t {
+  Magic = 0x4A695444, // "JiTD"
+  Version = 1
+};
+
+enum RecordType : uint32_t {
+  CodeLoad = 0,
+  CodeMove = 1,
+  CodeDebugInfo = 2,
+  CodeClose = 3
+};
+
+struct FileHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t TotalSize;
+  uint32_t ElfMach;
+  uint32_t Pad1;
+  uint32_t Pid;
+  uint64_t Timestamp;
+  uint64_t Flags;
+};
+
+struct RecordHeader {
+  uint32_t Id;
+  uint32_t TotalSize;
+  uint64_t Timestamp;
+};
+
+// Followed by the NUL-terminated function name and the code bytes.
+struct CodeLoadRecord {
+  RecordHeader Prefix;
+  uint32_t Pid;
+  uint32_t Tid;
+  uint64_t Vma;
+  uint64_t CodeAddr;
+  uint64_t CodeSize;
+  uint64_t CodeIndex;
+};
+
+// Followed by NrEntry DebugEntry records.
+struct DebugInfoRecord {
+  RecordHeader Prefix;
+  uint64_t CodeAddr;
+  uint64_t NrEntry;
+};
+
+// Followed by the NUL-terminated source file name.
+struct DebugEntry {
+  uint64_t Addr;
+  int32_t Line;
+  int32_t Discrim;
+};
+
+} // end namespace jitdump
+
+class PerfJITEventListener : public JITEventListener {
+  /// Serializes the writes to PerfMap and JitDump, so that objects emitted
+  /// on several threads do not interleave their records.
+  sys::Mutex Lock;
+  uint32_t Pid;
+  std::unique_ptr<raw_fd_ostream> PerfMap;
+  std::unique_ptr<raw_fd_ostream> JitDump;
+  void *JitDumpMarker = nullptr;
+  size_t JitDumpMarkerSize = 0;
+  uint64_t CodeIndex = 0;
+
+  void openPerfMap();
+  void openJitDump();
+
+  void writeCodeLoad(StringRef Name, uint64_t Addr, uint64_t Size);
+  void writeDebugInfo(uint64_t Addr, const DILineInfoTable &Lines);
+
+public:
+  PerfJITEventListener();
+  ~PerfJITEventListener() override;
+
+  void NotifyObjectEmitted(const ObjectFile &Obj,
+                           const RuntimeDyld::LoadedObjectInfo &L) override;
+};
+
+uint64_t getTimestamp() {
+  // perf orders jitdump records against its samples using CLOCK_MONOTONIC.
+  struct timespec TS;
+  if (clock_gettime(CLOCK_MONOTONIC, &TS))
+    return 0;
+  return uint64_t(TS.tv_sec) * 1000000000 + TS.tv_nsec;
+}
+
+uint32_t getElfMachine() {
+  switch (Triple(sys::getProcessTriple()).getArch()) {
+  case Triple::x86:       return ELF::EM_386;
+  case Triple::x86_64:    return ELF::EM_X86_64;
+  case Triple::arm:
+  case Triple::armeb:
+  case Triple::thumb:
+  case Triple::thumbeb:   return ELF::EM_ARM;
+  case Triple::aarch64:
+  case Triple::aarch64_be: return ELF::EM_AARCH64;
+  case Triple::mips:
+  case Triple::mipsel:
+  case Triple::mips64:
+  case Triple::mips64el:  return ELF::EM_MIPS;
+  case Triple::ppc:       return ELF::EM_PPC;
+  case Triple::ppc64:
+  case Triple::ppc64le:   return ELF::EM_PPC64;
+  case Triple::systemz:   return ELF::EM_S390;
+  default:                return ELF::EM_NONE;
+  }
+}
+
+PerfJITEventListener::PerfJITEventListener()
+    : Pid(static_cast<uint32_t>(::getpid())) {
+  openPerfMap();
+  openJitDump();
+}
+
+PerfJITEventListener::~PerfJITEventListener() {
+  MutexGuard Guard(Lock);
+  if (JitDump) {
+    jitdump::RecordHeader Close;
+    Close.Id = jitdump::CodeClose;
+    Close.TotalSize = sizeof(Close);
+    Close.Timestamp = getTimestamp();
+    JitDump->write(reinterpret_cast<const char *>(&Close), sizeof(Close));
+    JitDump->close();
+  }
+  if (JitDumpMarker)
+    ::munmap(JitDumpMarker, JitDumpMarkerSize);
+}
+
+void PerfJITEventListener::openPerfMap() {
+  SmallString<64> Path;
+  raw_svector_ostream(Path) << "/tmp/perf-" << Pid << ".map";
+
+  std::error_code EC;
+  PerfMap.reset(new raw_fd_ostream(Path, EC, sys::fs::F_Text));
+  if (EC) {
+    DEBUG(dbgs() << "Failed to open " << Path << ": " << EC.message() << "\n");
+    PerfMap.reset();
+  }
+}
+
+void PerfJITEventListener::openJitDump() {
+  SmallString<128> Path;
+  if (const char *Dir = ::getenv("JITDUMPDIR"))
+    Path = Dir;
+  else
+    sys::path::system_temp_directory(/*ErasedOnReboot=*/true, Path);
+  sys::path::append(Path, "jit-" + Twine(Pid) + ".dump");
+
+  int FD = ::open(Path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0666);
+  if (FD < 0) {
+    DEBUG(dbgs() << "Failed to open " << Path << ": " << sys::StrError()
+                 << "\n");
+    return;
+  }
+
+  // 'perf inject' finds the jitdump file through an executable mapping of it
+  // in the recorded process, so leave one in place for our lifetime.
+  JitDumpMarkerSize = sys::Process::getPageSize();
+  JitDumpMarker = ::mmap(nullptr, JitDumpMarkerSize, PROT_READ | PROT_EXEC,
+                         MAP_PRIVATE, FD, 0);
+  if (JitDumpMarker == MAP_FAILED) {
+    DEBUG(dbgs() << "Failed to map " << Path << ": " << sys::StrError()
+                 << "\n");
+    JitDumpMarker = nullptr;
+    ::close(FD);
+    return;
+  }
+
+  JitDump.reset(new raw_fd_ostream(FD, /*shouldClose=*/true));
+
+  jitdump::FileHeader Header;
+  Header.Magic = jitdump::Magic;
+  Header.Version = jitdump::Version;
+  Header.TotalSize = sizeof(Header);
+  Header.ElfMach = getElfMachine();
+  Header.Pad1 = 0;
+  Header.Pid = Pid;
+  Header.Timestamp = getTimestamp();
+  Header.Flags = 0;
+  JitDump->write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+}
+
+void PerfJITEventListener::writeCodeLoad(StringRef Name, uint64_t Addr,
+                                         uint64_t Size) {
+  jitdump::CodeLoadRecord Rec;
+  Rec.Prefix.Id = jitdump::CodeLoad;
+  Rec.Prefix.TotalSize = sizeof(Rec) + Name.size() + 1 + Size;
+  Rec.Prefix.Timestamp = getTimestamp();
+  Rec.Pid = Pid;
+  Rec.Tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+  Rec.Vma = Addr;
+  Rec.CodeAddr = Addr;
+  Rec.CodeSize = Size;
+  Rec.CodeIndex = CodeIndex++;
+
+  JitDump->write(reinterpret_cast<const char *>(&Rec), sizeof(Rec));
+  JitDump->write(Name.data(), Name.size());
+  JitDump->write('\0');
+  JitDump->write(reinterpret_cast<const char *>(Addr), Size);
+}
+
+void PerfJITEventListener::writeDebugInfo(uint64_t Addr,
+                                          const DILineInfoTable &Lines) {
+  jitdump::DebugInfoRecord Rec;
+  Rec.Prefix.Id = jitdump::CodeDebugInfo;
+  Rec.Prefix.TotalSize = sizeof(Rec);
+  Rec.Prefix.Timestamp = getTimestamp();
+  Rec.CodeAddr = Addr;
+  Rec.NrEntry = 0;
+  for (const auto &Line : Lines) {
+    if (Line.second.Line == 0)
+      continue;
+    Rec.Prefix.TotalSize +=
+        sizeof(jitdump::DebugEntry) + Line.second.FileName.size() + 1;
+    ++Rec.NrEntry;
+  }
+  if (Rec.NrEntry == 0)
+    return;
+
+  JitDump->write(reinterpret_cast<const char *>(&Rec), sizeof(Rec));
+  for (const auto &Line : Lines) {
+    if (Line.second.Line == 0)
+      continue;
+    jitdump::DebugEntry Entry;
+    Entry.Addr = Line.first;
+    Entry.Line = Line.second.Line;
+    Entry.Discrim = 0;
+    JitDump->write(reinterpret_cast<const char *>(&Entry), sizeof(Entry));
+    *JitDump << Line.second.FileName;
+    JitDump->write('\0');
+  }
+}
+
+void PerfJITEventListener::NotifyObjectEmitted(
+                                       const ObjectFile &Obj,
+                                       const RuntimeDyld::LoadedObjectInfo &L) {
+  if (!PerfMap && !JitDump)
+    return;
+
+  OwningBinary<ObjectFile> DebugObjOwner = L.getObjectForDebug(Obj);
+  const ObjectFile &DebugObj = *DebugObjOwner.getBinary();
+  std::unique_ptr<DIContext> Context;
+  if (JitDump)
+    Context.reset(new DWARFContextInMemory(DebugObj));
+
+  // Use symbol info to iterate functions in the object.
+  MutexGuard Guard(Lock);
+  for (const std::pair<SymbolRef, uint64_t> &P : computeSymbolSizes(DebugObj)) {
+    SymbolRef Sym = P.first;
+    if (Sym.getType() != SymbolRef::ST_Function)
+      continue;
+
+    ErrorOr<StringRef> NameOrErr = Sym.getName();
+    if (NameOrErr.getError())
+      continue;
+    StringRef Name = *NameOrErr;
+    ErrorOr<uint64_t> AddrOrErr = Sym.getAddress();
+    if (AddrOrErr.getError())
+      continue;
+    uint64_t Addr = *AddrOrErr;
+    uint64_t Size = P.second;
+    if (Size == 0)
+      continue;
+
+    if (PerfMap)
+      *PerfMap << format_hex_no_prefix(Addr, 1) << ' '
+               << format_hex_no_prefix(Size, 1) << ' ' << Name << '\n';
+
+    if (JitDump) {
+      // perf expects a function's line table ahead of its code.
+      writeDebugInfo(Addr, Context->getLineInfoForAddressRange(Addr, Size));
+      writeCodeLoad(Name, Addr, Size);
+    }
+  }
+
+  // Keep the files usable if the process dies before the listener does.
+  if (PerfMap)
+    PerfMap->flush();
+  if (JitDump)
+    JitDump->flush();
+}
+
+}  // anonymous namespace.
+
+namespace llvm {
+JITEventListener *JITEventListener::createPerfJITEventListener() {
+  return new PerfJITEventListener();
+}
+
+} // namespace llvm
@@ -802,56 +802,71 @@ void RuntimeDyldImpl::resolveRelocationList(const RelocationList &Relocs,
 }
 
 void RuntimeDyldImpl::resolveExternalSymbols() {
+  // Work through the pending symbols in rounds, looking each one up by name.
+  // Repeatedly taking begin() and erasing it would be quadratic: StringMap's
+  // begin() scans from the first bucket past the entries already erased.
+  // Resolving a symbol may load further objects which add new entries (and
+  // may rehash the map), so those are picked up by the next round.
+  std::vector<std::string> Names;
   while (!ExternalSymbolRelocations.empty()) {
-    StringMap<RelocationList>::iterator i = ExternalSymbolRelocations.begin();
-
-    StringRef Name = i->first();
-    if (Name.size() == 0) {
-      // This is an absolute symbol, use an address of zero.
-      DEBUG(dbgs() << "Resolving absolute relocations."
-                   << "\n");
-      RelocationList &Relocs = i->second;
-      resolveRelocationList(Relocs, 0);
-    } else {
-      uint64_t Addr = 0;
-      RTDyldSymbolTable::const_iterator Loc = GlobalSymbolTable.find(Name);
-      if (Loc == GlobalSymbolTable.end()) {
-        // This is an external symbol, try to get its address from the symbol
-        // resolver.
-        Addr = Resolver.findSymbol(Name.data()).getAddress();
-        // The call to getSymbolAddress may have caused additional modules to
-        // be loaded, which may have added new entries to the
-        // ExternalSymbolRelocations map.  Consquently, we need to update our
-        // iterator.  This is also why retrieval of the relocation list
-        // associated with this symbol is deferred until below this point.
-        // New entries may have been added to the relocation list.
-        i = ExternalSymbolRelocations.find(Name);
+    Names.clear();
+    for (const auto &Entry : ExternalSymbolRelocations)
+      Names.push_back(Entry.first());
+
+    for (const std::string &NameStr : Names) {
+      StringMap<RelocationList>::iterator i =
+        ExternalSymbolRelocations.find(NameStr);
+      if (i == ExternalSymbolRelocations.end())
+        continue;
+
+      StringRef Name = i->first();
+      if (Name.size() == 0) {
+        // This is an absolute symbol, use an address of zero.
+        DEBUG(dbgs() << "Resolving absolute relocations."
+                     << "\n");
+        RelocationList &Relocs = i->second;
+        resolveRelocationList(Relocs, 0);
       } else {
-        // We found the symbol in our global table.  It was probably in a
-        // Module that we loaded previously.
-        const auto &SymInfo = Loc->second;
-        Addr = getSectionLoadAddress(SymInfo.getSectionID()) +
-               SymInfo.getOffset();
+        uint64_t Addr = 0;
+        RTDyldSymbolTable::const_iterator Loc = GlobalSymbolTable.find(Name);
+        if (Loc == GlobalSymbolTable.end()) {
+          // This is an external symbol, try to get its address from the
+          // symbol resolver.
+          Addr = Resolver.findSymbol(NameStr).getAddress();
+          // The call to getSymbolAddress may have caused additional modules
+          // to be loaded, which may have added new entries to the
+          // ExternalSymbolRelocations map.  Consquently, we need to update
+          // our iterator.  This is also why retrieval of the relocation list
+          // associated with this symbol is deferred until below this point.
+          // New entries may have been added to the relocation list.
+          i = ExternalSymbolRelocations.find(NameStr);
+        } else {
+          // We found the symbol in our global table.  It was probably in a
+          // Module that we loaded previously.
+          const auto &SymInfo = Loc->second;
+          Addr = getSectionLoadAddress(SymInfo.getSectionID()) +
+                 SymInfo.getOffset();
+        }
+
+        // FIXME: Implement error handling that doesn't kill the host program!
+        if (!Addr)
+          report_fatal_error("Program used external function '" + NameStr +
+                             "' which could not be resolved!");
+
+        // If Resolver returned UINT64_MAX, the client wants to handle this
+        // symbol manually and we shouldn't resolve its relocations.
+        if (Addr != UINT64_MAX) {
+          DEBUG(dbgs() << "Resolving relocations Name: " << NameStr << "\t"
+                       << format("0x%lx", Addr) << "\n");
+          // This list may have been updated when we called getSymbolAddress,
+          // so don't change this code to get the list earlier.
+          RelocationList &Relocs = i->second;
+          resolveRelocationList(Relocs, Addr);
+        }
       }
 
-      // FIXME: Implement error handling that doesn't kill the host program!
-      if (!Addr)
-        report_fatal_error("Program used external function '" + Name +
-                           "' which could not be resolved!");
-
-      // If Resolver returned UINT64_MAX, the client wants to handle this symbol
-      // manually and we shouldn't resolve its relocations.
-      if (Addr != UINT64_MAX) {
-        DEBUG(dbgs() << "Resolving relocations Name: " << Name << "\t"
-                     << format("0x%lx", Addr) << "\n");
-        // This list may have been updated when we called getSymbolAddress, so
-        // don't change this code to get the list earlier.
-        RelocationList &Relocs = i->second;
-        resolveRelocationList(Relocs, Addr);
-      }
+      ExternalSymbolRelocations.erase(i);
     }
-
-    ExternalSymbolRelocations.erase(i);
   }
 }
 
@@ -74,17 +74,16 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
     }
   }
 
-  // No pre-allocated free block was large enough. Allocate a new memory region.
-  // Note that all sections get allocated as read-write.  The permissions will
-  // be updated later based on memory group.
-  //
-  // FIXME: It would be useful to define a default allocation size (or add
-  // it as a constructor parameter) to minimize the number of allocations.
+  // No pre-allocated free block was large enough. Allocate a new memory region
+  // of at least SlabSize bytes, so that subsequent allocations can be served
+  // from what is left over. Note that all sections get allocated as
+  // read-write.  The permissions will be updated later based on memory group.
   //
   // FIXME: Initialize the Near member for each memory group to avoid
   // interleaving.
   std::error_code ec;
-  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(RequiredSize,
+  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(std::max(RequiredSize,
+                                                                   SlabSize),
                                                           &MemGroup.Near,
                                                           sys::Memory::MF_READ |
                                                             sys::Memory::MF_WRITE,
@@ -180,8 +179,38 @@ static sys::MemoryBlock trimBlockToPageSize(sys::MemoryBlock M) {
 std::error_code
 SectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                                   unsigned Permissions) {
-  for (sys::MemoryBlock &MB : MemGroup.PendingMem)
-    if (std::error_code EC = sys::Memory::protectMappedMemory(MB, Permissions))
+  static const uintptr_t PageSize = sys::Process::getPageSize();
+
+  // Protect runs of pending blocks that touch the same or adjacent pages with
+  // a single call rather than one call per block. Every page in such a run
+  // holds part of a pending block, so the whole run is mapped and is to get
+  // the same permissions.
+  // Sort a copy: the free blocks refer to pending blocks by index.
+  SmallVector<sys::MemoryBlock, 16> Blocks(MemGroup.PendingMem.begin(),
+                                           MemGroup.PendingMem.end());
+  std::sort(Blocks.begin(), Blocks.end(),
+            [](const sys::MemoryBlock &A, const sys::MemoryBlock &B) {
+              return A.base() < B.base();
+            });
+  uintptr_t RunStart = 0, RunEnd = 0;
+  for (sys::MemoryBlock &MB : Blocks) {
+    uintptr_t Start = (uintptr_t)MB.base();
+    uintptr_t End = Start + MB.size();
+    if (RunEnd && Start <= alignTo(RunEnd, PageSize)) {
+      RunEnd = std::max(RunEnd, End);
+      continue;
+    }
+    if (RunEnd)
+      if (std::error_code EC = sys::Memory::protectMappedMemory(
+              sys::MemoryBlock((void *)RunStart, RunEnd - RunStart),
+              Permissions))
+        return EC;
+    RunStart = Start;
+    RunEnd = End;
+  }
+  if (RunEnd)
+    if (std::error_code EC = sys::Memory::protectMappedMemory(
+            sys::MemoryBlock((void *)RunStart, RunEnd - RunStart), Permissions))
       return EC;
 
   MemGroup.PendingMem.clear();
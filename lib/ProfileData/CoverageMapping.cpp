@@ -23,7 +23,9 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <mutex>
 
 using namespace llvm;
 using namespace coverage;
@@ -181,46 +183,162 @@ void FunctionRecordIterator::skipOtherFiles() {
     *this = FunctionRecordIterator();
 }
 
+/// Evaluate the regions of \p Record against the given counter values.
+/// Returns None if the record doesn't match the counters.
+static Optional<FunctionRecord>
+evaluateRecord(const CoverageMappingRecord &Record, ArrayRef<uint64_t> Counts) {
+  CounterMappingContext Ctx(Record.Expressions);
+  Ctx.setCounts(Counts);
+
+  assert(!Record.MappingRegions.empty() && "Function has no regions");
+
+  StringRef OrigFuncName = Record.FunctionName;
+  if (!Record.Filenames.empty())
+    OrigFuncName =
+        getFuncNameWithoutPrefix(OrigFuncName, Record.Filenames[0]);
+  FunctionRecord Function(OrigFuncName, Record.Filenames);
+  for (const auto &Region : Record.MappingRegions) {
+    ErrorOr<int64_t> ExecutionCount = Ctx.evaluate(Region.Count);
+    if (!ExecutionCount)
+      break;
+    Function.pushRegion(Region, *ExecutionCount);
+  }
+  if (Function.CountedRegions.size() != Record.MappingRegions.size())
+    return None;
+  return std::move(Function);
+}
+
+/// Look up the counters of \p Record in the profile. Returns false if the
+/// record should be counted as mismatched.
+static bool getRecordCounts(const CoverageMappingRecord &Record,
+                            IndexedInstrProfReader &ProfileReader,
+                            std::vector<uint64_t> &Counts,
+                            std::error_code &EC) {
+  Counts.clear();
+  EC = ProfileReader.getFunctionCounts(Record.FunctionName,
+                                       Record.FunctionHash, Counts);
+  if (!EC)
+    return true;
+  if (EC == instrprof_error::hash_mismatch) {
+    EC = std::error_code();
+    return false;
+  }
+  if (EC != instrprof_error::unknown_function)
+    return false;
+  EC = std::error_code();
+  Counts.assign(Record.MappingRegions.size(), 0);
+  return true;
+}
+
 ErrorOr<std::unique_ptr<CoverageMapping>>
 CoverageMapping::load(CoverageMappingReader &CoverageReader,
                       IndexedInstrProfReader &ProfileReader) {
   auto Coverage = std::unique_ptr<CoverageMapping>(new CoverageMapping());
 
   std::vector<uint64_t> Counts;
+  std::error_code EC;
   for (const auto &Record : CoverageReader) {
-    CounterMappingContext Ctx(Record.Expressions);
-
-    Counts.clear();
-    if (std::error_code EC = ProfileReader.getFunctionCounts(
-            Record.FunctionName, Record.FunctionHash, Counts)) {
-      if (EC == instrprof_error::hash_mismatch) {
-        Coverage->MismatchedFunctionCount++;
-        continue;
-      } else if (EC != instrprof_error::unknown_function)
-        return EC;
-      Counts.assign(Record.MappingRegions.size(), 0);
+    bool Matched = getRecordCounts(Record, ProfileReader, Counts, EC);
+    if (EC)
+      return EC;
+    Optional<FunctionRecord> Function;
+    if (Matched)
+      Function = evaluateRecord(Record, Counts);
+    if (!Function) {
+      Coverage->MismatchedFunctionCount++;
+      continue;
     }
-    Ctx.setCounts(Counts);
-
-    assert(!Record.MappingRegions.empty() && "Function has no regions");
-
-    StringRef OrigFuncName = Record.FunctionName;
-    if (!Record.Filenames.empty())
-      OrigFuncName =
-          getFuncNameWithoutPrefix(OrigFuncName, Record.Filenames[0]);
-    FunctionRecord Function(OrigFuncName, Record.Filenames);
-    for (const auto &Region : Record.MappingRegions) {
-      ErrorOr<int64_t> ExecutionCount = Ctx.evaluate(Region.Count);
-      if (!ExecutionCount)
-        break;
-      Function.pushRegion(Region, *ExecutionCount);
+    Coverage->Functions.push_back(std::move(*Function));
+  }
+
+  return std::move(Coverage);
+}
+
+namespace {
+/// \brief The functions decoded from a contiguous range of mapping records.
+struct RecordRange {
+  size_t Begin, End;
+  std::vector<FunctionRecord> Functions;
+  unsigned MismatchedFunctionCount;
+  /// Set if a record in the range could not be decoded; the range stops
+  /// there, just like iterating over the reader would.
+  bool Truncated;
+  std::error_code ProfileError;
+
+  RecordRange(size_t Begin, size_t End)
+      : Begin(Begin), End(End), MismatchedFunctionCount(0), Truncated(false) {}
+};
+}
+
+static void loadRecordRange(const BinaryCoverageReader &CoverageReader,
+                            IndexedInstrProfReader &ProfileReader,
+                            std::mutex &ProfileLock, RecordRange &Range) {
+  std::vector<StringRef> Filenames;
+  std::vector<CounterExpression> Expressions;
+  std::vector<CounterMappingRegion> MappingRegions;
+  std::vector<uint64_t> Counts;
+  CoverageMappingRecord Record;
+  for (size_t I = Range.Begin; I != Range.End; ++I) {
+    if (CoverageReader.readRecord(I, Record, Filenames, Expressions,
+                                  MappingRegions)) {
+      Range.Truncated = true;
+      return;
     }
-    if (Function.CountedRegions.size() != Record.MappingRegions.size()) {
-      Coverage->MismatchedFunctionCount++;
+
+    bool Matched;
+    {
+      std::lock_guard<std::mutex> Guard(ProfileLock);
+      Matched = getRecordCounts(Record, ProfileReader, Counts,
+                                Range.ProfileError);
+    }
+    if (Range.ProfileError)
+      return;
+    Optional<FunctionRecord> Function;
+    if (Matched)
+      Function = evaluateRecord(Record, Counts);
+    if (!Function) {
+      Range.MismatchedFunctionCount++;
       continue;
     }
+    Range.Functions.push_back(std::move(*Function));
+  }
+}
 
-    Coverage->Functions.push_back(std::move(Function));
+ErrorOr<std::unique_ptr<CoverageMapping>>
+CoverageMapping::load(BinaryCoverageReader &CoverageReader,
+                      IndexedInstrProfReader &ProfileReader,
+                      unsigned NumThreads) {
+  size_t NumRecords = CoverageReader.getNumRecords();
+  if (NumThreads <= 1 || NumRecords < 2)
+    return load(static_cast<CoverageMappingReader &>(CoverageReader),
+                ProfileReader);
+
+  // Hand out several ranges per thread so that an unlucky range full of
+  // large functions doesn't leave the other threads idle.
+  size_t RangeSize = std::max<size_t>(1, NumRecords / (NumThreads * 8));
+  std::vector<RecordRange> Ranges;
+  for (size_t I = 0; I < NumRecords; I += RangeSize)
+    Ranges.emplace_back(I, std::min(I + RangeSize, NumRecords));
+
+  std::mutex ProfileLock;
+  ThreadPool Pool(NumThreads);
+  for (auto &Range : Ranges)
+    Pool.async([&CoverageReader, &ProfileReader, &ProfileLock, &Range]() {
+      loadRecordRange(CoverageReader, ProfileReader, ProfileLock, Range);
+    });
+  Pool.wait();
+
+  // Stitch the ranges back together in order, so that the result is the
+  // same as that of a sequential load.
+  auto Coverage = std::unique_ptr<CoverageMapping>(new CoverageMapping());
+  for (auto &Range : Ranges) {
+    if (Range.ProfileError)
+      return Range.ProfileError;
+    Coverage->MismatchedFunctionCount += Range.MismatchedFunctionCount;
+    std::move(Range.Functions.begin(), Range.Functions.end(),
+              std::back_inserter(Coverage->Functions));
+    if (Range.Truncated)
+      break;
   }
 
   return std::move(Coverage);
@@ -228,7 +346,7 @@ CoverageMapping::load(CoverageMappingReader &CoverageReader,
 
 ErrorOr<std::unique_ptr<CoverageMapping>>
 CoverageMapping::load(StringRef ObjectFilename, StringRef ProfileFilename,
-                      StringRef Arch) {
+                      StringRef Arch, unsigned NumThreads) {
   auto CounterMappingBuff = MemoryBuffer::getFileOrSTDIN(ObjectFilename);
   if (std::error_code EC = CounterMappingBuff.getError())
     return EC;
@@ -241,7 +359,7 @@ CoverageMapping::load(StringRef ObjectFilename, StringRef ProfileFilename,
   if (auto EC = ProfileReaderOrErr.getError())
     return EC;
   auto ProfileReader = std::move(ProfileReaderOrErr.get());
-  return load(*CoverageReader, *ProfileReader);
+  return load(*CoverageReader, *ProfileReader, NumThreads);
 }
 
 namespace {
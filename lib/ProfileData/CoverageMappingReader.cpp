@@ -590,10 +590,23 @@ BinaryCoverageReader::readNextRecord(CoverageMappingRecord &Record) {
   if (CurrentRecord >= MappingRecords.size())
     return coveragemap_error::eof;
 
+  if (auto Err = readRecord(CurrentRecord, Record, FunctionsFilenames,
+                            Expressions, MappingRegions))
+    return Err;
+
+  ++CurrentRecord;
+  return std::error_code();
+}
+
+std::error_code BinaryCoverageReader::readRecord(
+    size_t Index, CoverageMappingRecord &Record,
+    std::vector<StringRef> &FunctionsFilenames,
+    std::vector<CounterExpression> &Expressions,
+    std::vector<CounterMappingRegion> &MappingRegions) const {
   FunctionsFilenames.clear();
   Expressions.clear();
   MappingRegions.clear();
-  auto &R = MappingRecords[CurrentRecord];
+  auto &R = MappingRecords[Index];
   RawCoverageMappingReader Reader(
       R.CoverageMapping,
       makeArrayRef(Filenames).slice(R.FilenamesBegin, R.FilenamesSize),
@@ -606,7 +619,5 @@ BinaryCoverageReader::readNextRecord(CoverageMappingRecord &Record) {
   Record.Filenames = FunctionsFilenames;
   Record.Expressions = Expressions;
   Record.MappingRegions = MappingRegions;
-
-  ++CurrentRecord;
   return std::error_code();
 }
@@ -283,7 +283,12 @@ instrprof_error InstrProfValueSiteRecord::merge(InstrProfValueSiteRecord &Input,
       ++I;
       continue;
     }
-    ValueData.insert(I, *J);
+    InstrProfValueData VD = *J;
+    bool Overflowed;
+    VD.Count = SaturatingMultiply(VD.Count, Weight, &Overflowed);
+    if (Overflowed)
+      Result = instrprof_error::counter_overflow;
+    ValueData.insert(I, VD);
   }
   return Result;
 }
@@ -442,7 +447,7 @@ ValueProfData *allocValueProfDataInstrProf(size_t TotalSizeInBytes) {
   return VD;
 }
 
-static ValueProfRecordClosure InstrProfRecordClosure = {
+static const ValueProfRecordClosure InstrProfRecordClosure = {
     0,
     getNumValueKindsInstrProf,
     getNumValueSitesInstrProf,
@@ -453,18 +458,22 @@ static ValueProfRecordClosure InstrProfRecordClosure = {
     allocValueProfDataInstrProf};
 
 // Wrapper implementation using the closure mechanism.
+// Each call works on its own copy of the closure so that records can be
+// serialized on several threads at once.
 uint32_t ValueProfData::getSize(const InstrProfRecord &Record) {
-  InstrProfRecordClosure.Record = &Record;
-  return getValueProfDataSize(&InstrProfRecordClosure);
+  ValueProfRecordClosure Closure = InstrProfRecordClosure;
+  Closure.Record = &Record;
+  return getValueProfDataSize(&Closure);
 }
 
 // Wrapper implementation using the closure mechanism.
 std::unique_ptr<ValueProfData>
 ValueProfData::serializeFrom(const InstrProfRecord &Record) {
-  InstrProfRecordClosure.Record = &Record;
+  ValueProfRecordClosure Closure = InstrProfRecordClosure;
+  Closure.Record = &Record;
 
   std::unique_ptr<ValueProfData> VPD(
-      serializeValueProfDataFrom(&InstrProfRecordClosure, nullptr));
+      serializeValueProfDataFrom(&Closure, nullptr));
   return VPD;
 }
 
@@ -458,6 +458,53 @@ bool InstrProfLookupTrait::readValueProfilingData(
   return true;
 }
 
+bool InstrProfLookupTrait::skipValueProfilingData(
+    const unsigned char *&D, const unsigned char *const End) {
+  // The leading TotalSize field covers the whole value profile data block.
+  if (D + sizeof(uint32_t) > End)
+    return false;
+  uint32_t TotalSize;
+  if (ValueProfDataEndianness == support::little)
+    TotalSize = support::endian::read<uint32_t, support::little,
+                                      support::unaligned>(D);
+  else
+    TotalSize = support::endian::read<uint32_t, support::big,
+                                      support::unaligned>(D);
+  if (TotalSize < sizeof(ValueProfData) || D + TotalSize > End)
+    return false;
+  D += TotalSize;
+  return true;
+}
+
+bool InstrProfLookupTrait::readCounts(const unsigned char *&D,
+                                      const unsigned char *const End,
+                                      offset_type N, uint64_t &Hash,
+                                      std::vector<uint64_t> &Counts) {
+  using namespace support;
+  // Read hash.
+  if (D + sizeof(uint64_t) >= End)
+    return false;
+  Hash = endian::readNext<uint64_t, little, unaligned>(D);
+
+  // Initialize number of counters for FormatVersion == 1.
+  uint64_t CountsSize = N / sizeof(uint64_t) - 1;
+  // If format version is different then read the number of counters.
+  if (FormatVersion != IndexedInstrProf::ProfVersion::Version1) {
+    if (D + sizeof(uint64_t) > End)
+      return false;
+    CountsSize = endian::readNext<uint64_t, little, unaligned>(D);
+  }
+  // Read counter values.
+  if (D + CountsSize * sizeof(uint64_t) > End)
+    return false;
+
+  Counts.clear();
+  Counts.reserve(CountsSize);
+  for (uint64_t J = 0; J < CountsSize; ++J)
+    Counts.push_back(endian::readNext<uint64_t, little, unaligned>(D));
+  return true;
+}
+
 data_type InstrProfLookupTrait::ReadData(StringRef K, const unsigned char *D,
                                          offset_type N) {
   // Check if the data is corrupt. If so, don't try to read it.
@@ -467,31 +514,12 @@ data_type InstrProfLookupTrait::ReadData(StringRef K, const unsigned char *D,
   DataBuffer.clear();
   std::vector<uint64_t> CounterBuffer;
 
-  using namespace support;
   const unsigned char *End = D + N;
   while (D < End) {
-    // Read hash.
-    if (D + sizeof(uint64_t) >= End)
-      return data_type();
-    uint64_t Hash = endian::readNext<uint64_t, little, unaligned>(D);
-
-    // Initialize number of counters for FormatVersion == 1.
-    uint64_t CountsSize = N / sizeof(uint64_t) - 1;
-    // If format version is different then read the number of counters.
-    if (FormatVersion != IndexedInstrProf::ProfVersion::Version1) {
-      if (D + sizeof(uint64_t) > End)
-        return data_type();
-      CountsSize = endian::readNext<uint64_t, little, unaligned>(D);
-    }
-    // Read counter values.
-    if (D + CountsSize * sizeof(uint64_t) > End)
+    uint64_t Hash;
+    if (!readCounts(D, End, N, Hash, CounterBuffer))
       return data_type();
 
-    CounterBuffer.clear();
-    CounterBuffer.reserve(CountsSize);
-    for (uint64_t J = 0; J < CountsSize; ++J)
-      CounterBuffer.push_back(endian::readNext<uint64_t, little, unaligned>(D));
-
     DataBuffer.emplace_back(K, Hash, std::move(CounterBuffer));
 
     // Read value profiling data.
@@ -504,6 +532,44 @@ data_type InstrProfLookupTrait::ReadData(StringRef K, const unsigned char *D,
   return DataBuffer;
 }
 
+std::error_code InstrProfLookupTrait::ReadRecord(StringRef K,
+                                                 const unsigned char *D,
+                                                 offset_type N,
+                                                 uint64_t FuncHash,
+                                                 InstrProfRecord &Record,
+                                                 bool ReadValueData) {
+  if (N % sizeof(uint64_t))
+    return instrprof_error::malformed;
+
+  bool HasValueData =
+      FormatVersion > IndexedInstrProf::ProfVersion::Version2;
+  std::vector<uint64_t> Counts;
+  const unsigned char *End = D + N;
+  while (D < End) {
+    uint64_t Hash;
+    if (!readCounts(D, End, N, Hash, Counts))
+      return instrprof_error::malformed;
+
+    if (Hash != FuncHash) {
+      if (HasValueData && !skipValueProfilingData(D, End))
+        return instrprof_error::malformed;
+      continue;
+    }
+
+    Record = InstrProfRecord(K, Hash, std::move(Counts));
+    if (!HasValueData || !ReadValueData)
+      return instrprof_error::success;
+
+    ErrorOr<std::unique_ptr<ValueProfData>> VDataPtrOrErr =
+        ValueProfData::getValueProfData(D, End, ValueProfDataEndianness);
+    if (VDataPtrOrErr.getError())
+      return instrprof_error::malformed;
+    VDataPtrOrErr.get()->deserializeTo(Record, nullptr);
+    return instrprof_error::success;
+  }
+  return instrprof_error::hash_mismatch;
+}
+
 template <typename HashTableImpl>
 std::error_code InstrProfReaderIndex<HashTableImpl>::getRecords(
     StringRef FuncName, ArrayRef<InstrProfRecord> &Data) {
@@ -518,6 +584,21 @@ std::error_code InstrProfReaderIndex<HashTableImpl>::getRecords(
   return instrprof_error::success;
 }
 
+template <typename HashTableImpl>
+std::error_code InstrProfReaderIndex<HashTableImpl>::getRecord(
+    StringRef FuncName, uint64_t FuncHash, InstrProfRecord &Record,
+    bool ReadValueData) {
+  auto Iter = HashTable->find(FuncName);
+  if (Iter == HashTable->end())
+    return instrprof_error::unknown_function;
+
+  // Walk the mapped data directly rather than going through ReadData, which
+  // would materialize every record stored under this name.
+  return HashTable->getInfoObj().ReadRecord(FuncName, Iter.getDataPtr(),
+                                            Iter.getDataLen(), FuncHash,
+                                            Record, ReadValueData);
+}
+
 template <typename HashTableImpl>
 std::error_code InstrProfReaderIndex<HashTableImpl>::getRecords(
     ArrayRef<InstrProfRecord> &Data) {
@@ -610,28 +691,28 @@ InstrProfSymtab &IndexedInstrProfReader::getSymtab() {
 ErrorOr<InstrProfRecord>
 IndexedInstrProfReader::getInstrProfRecord(StringRef FuncName,
                                            uint64_t FuncHash) {
-  ArrayRef<InstrProfRecord> Data;
-  std::error_code EC = Index->getRecords(FuncName, Data);
+  InstrProfRecord Record;
+  std::error_code EC = Index->getRecord(FuncName, FuncHash, Record,
+                                        /*ReadValueData=*/true);
+  if (EC == instrprof_error::hash_mismatch)
+    return error(EC);
   if (EC != instrprof_error::success)
     return EC;
-  // Found it. Look for counters with the right hash.
-  for (unsigned I = 0, E = Data.size(); I < E; ++I) {
-    // Check for a match and fill the vector if there is one.
-    if (Data[I].Hash == FuncHash) {
-      return std::move(Data[I]);
-    }
-  }
-  return error(instrprof_error::hash_mismatch);
+  return std::move(Record);
 }
 
 std::error_code
 IndexedInstrProfReader::getFunctionCounts(StringRef FuncName, uint64_t FuncHash,
                                           std::vector<uint64_t> &Counts) {
-  ErrorOr<InstrProfRecord> Record = getInstrProfRecord(FuncName, FuncHash);
-  if (std::error_code EC = Record.getError())
+  InstrProfRecord Record;
+  std::error_code EC = Index->getRecord(FuncName, FuncHash, Record,
+                                        /*ReadValueData=*/false);
+  if (EC == instrprof_error::hash_mismatch)
+    return error(EC);
+  if (EC != instrprof_error::success)
     return EC;
 
-  Counts = Record.get().Counts;
+  Counts = std::move(Record.Counts);
   return success();
 }
 
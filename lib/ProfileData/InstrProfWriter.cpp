@@ -15,7 +15,11 @@
 #include "llvm/ProfileData/InstrProfWriter.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/OnDiskHashTable.h"
+#include <algorithm>
+#include <queue>
 #include <tuple>
 
 using namespace llvm;
@@ -139,6 +143,230 @@ public:
     }
   }
 };
+
+/// Emits records that have already been serialized by
+/// InstrProfRecordTrait::EmitData.
+class SerializedRecordTrait {
+public:
+  typedef StringRef key_type;
+  typedef StringRef key_type_ref;
+
+  typedef StringRef data_type;
+  typedef StringRef data_type_ref;
+
+  typedef uint64_t hash_value_type;
+  typedef uint64_t offset_type;
+
+  static hash_value_type ComputeHash(key_type_ref K) {
+    return IndexedInstrProf::ComputeHash(K);
+  }
+
+  static std::pair<offset_type, offset_type>
+  EmitKeyDataLength(raw_ostream &Out, key_type_ref K, data_type_ref V) {
+    using namespace llvm::support;
+    endian::Writer<little> LE(Out);
+    LE.write<offset_type>(K.size());
+    LE.write<offset_type>(V.size());
+    return std::make_pair(K.size(), V.size());
+  }
+
+  static void EmitKey(raw_ostream &Out, key_type_ref K, offset_type N) {
+    Out.write(K.data(), N);
+  }
+
+  static void EmitData(raw_ostream &Out, key_type_ref, data_type_ref V,
+                       offset_type) {
+    Out << V;
+  }
+};
+
+// A spilled run is a sequence of records sorted by name and hash. Each record
+// holds the name size, the name padded to 8 bytes, the function hash, the
+// number of counters, the counters and the record's ValueProfData, all in
+// little-endian order.
+void writeRunRecord(raw_ostream &OS, const InstrProfRecord &Record) {
+  using namespace llvm::support;
+  endian::Writer<little> LE(OS);
+  LE.write<uint64_t>(Record.Name.size());
+  OS << Record.Name;
+  for (uint64_t I = Record.Name.size(), E = alignTo(I, 8); I != E; ++I)
+    OS << '\0';
+  LE.write<uint64_t>(Record.Hash);
+  LE.write<uint64_t>(Record.Counts.size());
+  for (uint64_t I : Record.Counts)
+    LE.write<uint64_t>(I);
+
+  std::unique_ptr<ValueProfData> VDataPtr =
+      ValueProfData::serializeFrom(Record);
+  uint32_t S = VDataPtr->getSize();
+  VDataPtr->swapBytesFromHost(little);
+  OS.write((const char *)VDataPtr.get(), S);
+}
+
+/// Reads the records of a spilled run in order. Record names point into the
+/// run's buffer, so they stay valid as long as the reader does.
+class SpillRunReader {
+  std::unique_ptr<MemoryBuffer> Buffer;
+  const unsigned char *Cur;
+  const unsigned char *End;
+
+public:
+  /// The record most recently read by next().
+  InstrProfRecord Record;
+  /// The position of the run in the order the runs were spilled.
+  unsigned Index;
+  /// Set if next() stopped because the run is malformed.
+  std::error_code Err;
+
+  SpillRunReader(std::unique_ptr<MemoryBuffer> RunBuffer, unsigned Index)
+      : Buffer(std::move(RunBuffer)),
+        Cur(reinterpret_cast<const unsigned char *>(Buffer->getBufferStart())),
+        End(reinterpret_cast<const unsigned char *>(Buffer->getBufferEnd())),
+        Index(Index) {}
+
+  /// Read the next record into Record. Returns false at the end of the run,
+  /// or with Err set if the run is malformed.
+  bool next() {
+    using namespace llvm::support;
+    if (Cur == End)
+      return false;
+
+    Record = InstrProfRecord();
+    uint64_t NameSize = endian::readNext<uint64_t, little, unaligned>(Cur);
+    Record.Name = StringRef(reinterpret_cast<const char *>(Cur), NameSize);
+    Cur += alignTo(NameSize, 8);
+    Record.Hash = endian::readNext<uint64_t, little, unaligned>(Cur);
+    uint64_t NumCounts = endian::readNext<uint64_t, little, unaligned>(Cur);
+    Record.Counts.reserve(NumCounts);
+    for (uint64_t I = 0; I < NumCounts; ++I)
+      Record.Counts.push_back(
+          endian::readNext<uint64_t, little, unaligned>(Cur));
+
+    ErrorOr<std::unique_ptr<ValueProfData>> VDataPtrOrErr =
+        ValueProfData::getValueProfData(Cur, End, little);
+    if ((Err = VDataPtrOrErr.getError())) {
+      Cur = End;
+      return false;
+    }
+    Cur += VDataPtrOrErr.get()->getSize();
+    VDataPtrOrErr.get()->deserializeTo(Record, nullptr);
+    return true;
+  }
+};
+
+typedef std::vector<std::unique_ptr<SpillRunReader>> SpillRunReaderList;
+
+/// Open each of the spilled runs in \p Files.
+std::error_code openSpillRuns(ArrayRef<std::string> Files,
+                              SpillRunReaderList &Readers) {
+  for (const std::string &File : Files) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getFile(File, -1, /*RequiresNullTerminator=*/false);
+    if (std::error_code EC = BufferOrErr.getError())
+      return EC;
+    Readers.push_back(llvm::make_unique<SpillRunReader>(
+        std::move(BufferOrErr.get()), Readers.size()));
+  }
+  return std::error_code();
+}
+
+/// Merge the runs read by \p Readers, passing each function name with its
+/// merged records to \p Callback in name order. As in addRecord, records are
+/// merged in the order they were added, and those that cannot be merged are
+/// reported to \p Warn and dropped. Stops at the first malformed run.
+std::error_code mergeSpillRuns(
+    SpillRunReaderList &Readers, const InstrProfWriter::WarningHandler &Warn,
+    function_ref<void(StringRef, InstrProfWriter::ProfilingData &)> Callback) {
+  auto Greater = [](const SpillRunReader *LHS, const SpillRunReader *RHS) {
+    return std::tie(LHS->Record.Name, LHS->Record.Hash, LHS->Index) >
+           std::tie(RHS->Record.Name, RHS->Record.Hash, RHS->Index);
+  };
+  std::priority_queue<SpillRunReader *, std::vector<SpillRunReader *>,
+                      decltype(Greater)>
+      Heap(Greater);
+  for (auto &Reader : Readers)
+    if (Reader->next())
+      Heap.push(Reader.get());
+    else if (Reader->Err)
+      return Reader->Err;
+
+  InstrProfWriter::ProfilingData Group;
+  StringRef GroupName;
+  while (!Heap.empty()) {
+    SpillRunReader *Reader = Heap.top();
+    Heap.pop();
+
+    InstrProfRecord &Record = Reader->Record;
+    if (!Group.empty() && Record.Name != GroupName) {
+      Callback(GroupName, Group);
+      Group.clear();
+    }
+    GroupName = Record.Name;
+
+    bool NewFunc;
+    InstrProfWriter::ProfilingData::iterator Where;
+    std::tie(Where, NewFunc) =
+        Group.insert(std::make_pair(Record.Hash, InstrProfRecord()));
+    if (NewFunc) {
+      Where->second = std::move(Record);
+    } else {
+      instrprof_error Result = Where->second.merge(Record);
+      Where->second.sortValueData();
+      if (Result != instrprof_error::success && Warn)
+        Warn(make_error_code(Result), GroupName);
+    }
+
+    if (Reader->next())
+      Heap.push(Reader);
+    else if (Reader->Err)
+      return Reader->Err;
+  }
+  if (!Group.empty())
+    Callback(GroupName, Group);
+  return std::error_code();
+}
+
+/// Write the indexed profile header followed by the hash table built by
+/// \p Generator.
+template <typename GeneratorT>
+void writeIndexedProfile(ProfOStream &OS, GeneratorT &Generator,
+                         uint64_t MaxFunctionCount) {
+  // Write the header.
+  IndexedInstrProf::Header Header;
+  Header.Magic = IndexedInstrProf::Magic;
+  Header.Version = IndexedInstrProf::ProfVersion::CurrentVersion;
+  Header.MaxFunctionCount = MaxFunctionCount;
+  Header.HashType = static_cast<uint64_t>(IndexedInstrProf::HashType);
+  Header.HashOffset = 0;
+  int N = sizeof(IndexedInstrProf::Header) / sizeof(uint64_t);
+
+  // Only write out all the fields execpt 'HashOffset'. We need
+  // to remember the offset of that field to allow back patching
+  // later.
+  for (int I = 0; I < N - 1; I++)
+    OS.write(reinterpret_cast<uint64_t *>(&Header)[I]);
+
+  // Save a space to write the hash table start location.
+  uint64_t HashTableStartLoc = OS.tell();
+  // Reserve the space for HashOffset field.
+  OS.write(0);
+  // Write the hash table.
+  uint64_t HashTableStart = Generator.Emit(OS.OS);
+
+  // Now do the final patch:
+  PatchItem PatchItems[1] = {{HashTableStartLoc, &HashTableStart, 1}};
+  OS.patch(PatchItems, sizeof(PatchItems) / sizeof(*PatchItems));
+}
+}
+
+InstrProfWriter::~InstrProfWriter() {
+  for (const std::string &File : SpillFiles)
+    sys::fs::remove(File);
+}
+
+void InstrProfWriter::setMemoryLimit(uint64_t Bytes, WarningHandler Warn) {
+  MemoryLimit = Bytes;
+  SpillWarn = std::move(Warn);
 }
 
 // Internal interface for testing purpose only.
@@ -147,6 +375,11 @@ void InstrProfWriter::setValueProfDataEndianness(
   ValueProfDataEndianness = Endianness;
 }
 
+/// Approximate number of bytes held by the counters and value data of \p R.
+static uint64_t getRecordDataSize(const InstrProfRecord &R) {
+  return R.Counts.size() * sizeof(uint64_t) + ValueProfData::getSize(R);
+}
+
 std::error_code InstrProfWriter::addRecord(InstrProfRecord &&I,
                                            uint64_t Weight) {
   auto &ProfileDataMap = FunctionData[I.Name];
@@ -157,6 +390,10 @@ std::error_code InstrProfWriter::addRecord(InstrProfRecord &&I,
       ProfileDataMap.insert(std::make_pair(I.Hash, InstrProfRecord()));
   InstrProfRecord &Dest = Where->second;
 
+  uint64_t OldSize = 0;
+  if (MemoryLimit && !NewFunc)
+    OldSize = getRecordDataSize(Dest);
+
   instrprof_error Result = instrprof_error::success;
   if (NewFunc) {
     // We've never seen a function with this name and hash, add it.
@@ -177,45 +414,152 @@ std::error_code InstrProfWriter::addRecord(InstrProfRecord &&I,
   if (Dest.Counts[0] > MaxFunctionCount)
     MaxFunctionCount = Dest.Counts[0];
 
+  if (MemoryLimit) {
+    // Merging never shrinks a record, but may add value data to it.
+    if (NewFunc)
+      MemoryUsage += sizeof(ProfilingData::value_type) + Dest.Name.size();
+    MemoryUsage += getRecordDataSize(Dest) - OldSize;
+    // Failing to spill takes precedence over any merge warning.
+    if (MemoryUsage > MemoryLimit)
+      if (std::error_code EC = spill())
+        return EC;
+  }
+
   return Result;
 }
 
-void InstrProfWriter::writeImpl(ProfOStream &OS) {
-  OnDiskChainedHashTableGenerator<InstrProfRecordTrait> Generator;
-  // Populate the hash table generator.
-  for (const auto &I : FunctionData)
-    Generator.insert(I.getKey(), &I.getValue());
-  // Write the header.
-  IndexedInstrProf::Header Header;
-  Header.Magic = IndexedInstrProf::Magic;
-  Header.Version = IndexedInstrProf::ProfVersion::CurrentVersion;
-  Header.MaxFunctionCount = MaxFunctionCount;
-  Header.HashType = static_cast<uint64_t>(IndexedInstrProf::HashType);
-  Header.HashOffset = 0;
-  int N = sizeof(IndexedInstrProf::Header) / sizeof(uint64_t);
+std::error_code InstrProfWriter::spill() {
+  int FD;
+  SmallString<128> Path;
+  if (std::error_code EC =
+          sys::fs::createTemporaryFile("instrprof-run", "tmp", FD, Path))
+    return EC;
+
+  // Write the records sorted by name and hash so that runs can be merged
+  // without reading them into memory.
+  std::vector<StringMapEntry<ProfilingData> *> Functions;
+  Functions.reserve(FunctionData.size());
+  for (auto &I : FunctionData)
+    Functions.push_back(&I);
+  std::sort(Functions.begin(), Functions.end(),
+            [](const StringMapEntry<ProfilingData> *LHS,
+               const StringMapEntry<ProfilingData> *RHS) {
+              return LHS->getKey() < RHS->getKey();
+            });
+
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  std::vector<uint64_t> Hashes;
+  for (StringMapEntry<ProfilingData> *Function : Functions) {
+    ProfilingData &Data = Function->getValue();
+    Hashes.clear();
+    for (const auto &I : Data)
+      Hashes.push_back(I.first);
+    std::sort(Hashes.begin(), Hashes.end());
+    for (uint64_t Hash : Hashes)
+      writeRunRecord(OS, Data.find(Hash)->second);
+  }
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    sys::fs::remove(Path);
+    return make_error_code(errc::io_error);
+  }
 
-  // Only write out all the fields execpt 'HashOffset'. We need
-  // to remember the offset of that field to allow back patching
-  // later.
-  for (int I = 0; I < N - 1; I++)
-    OS.write(reinterpret_cast<uint64_t *>(&Header)[I]);
+  SpillFiles.push_back(Path.str());
+  FunctionData.clear();
+  MemoryUsage = 0;
+  return std::error_code();
+}
 
-  // Save a space to write the hash table start location.
-  uint64_t HashTableStartLoc = OS.tell();
-  // Reserve the space for HashOffset field.
-  OS.write(0);
-  // Write the hash table.
-  uint64_t HashTableStart = Generator.Emit(OS.OS);
+void InstrProfWriter::mergeRecordsFromWriter(
+    InstrProfWriter &&IPW,
+    function_ref<void(std::error_code, StringRef)> Warn) {
+  for (auto &I : IPW.FunctionData)
+    for (auto &Func : I.getValue())
+      if (std::error_code EC = addRecord(std::move(Func.second)))
+        Warn(EC, I.getKey());
+  IPW.FunctionData.clear();
+
+  // The spilled runs of IPW are merged with ours when the profile is written.
+  SpillFiles.insert(SpillFiles.end(), IPW.SpillFiles.begin(),
+                    IPW.SpillFiles.end());
+  IPW.SpillFiles.clear();
+  MaxFunctionCount = std::max(MaxFunctionCount, IPW.MaxFunctionCount);
+  IPW.MaxFunctionCount = 0;
+  IPW.MemoryUsage = 0;
+}
 
-  // Now do the final patch:
-  PatchItem PatchItems[1] = {{HashTableStartLoc, &HashTableStart, 1}};
-  OS.patch(PatchItems, sizeof(PatchItems) / sizeof(*PatchItems));
+std::error_code InstrProfWriter::writeImpl(ProfOStream &OS) {
+  if (SpillFiles.empty()) {
+    OnDiskChainedHashTableGenerator<InstrProfRecordTrait> Generator;
+    // Populate the hash table generator.
+    for (const auto &I : FunctionData)
+      Generator.insert(I.getKey(), &I.getValue());
+    writeIndexedProfile(OS, Generator, MaxFunctionCount);
+    return std::error_code();
+  }
+
+  // Merge everything through the runs. The merged records of each function
+  // are serialized to a scratch file as they are produced, so only the keys
+  // of the hash table are kept in memory.
+  if (!FunctionData.empty())
+    if (std::error_code EC = spill())
+      return EC;
+
+  SpillRunReaderList Readers;
+  if (std::error_code EC = openSpillRuns(SpillFiles, Readers))
+    return EC;
+
+  int FD;
+  SmallString<128> ScratchPath;
+  if (std::error_code EC = sys::fs::createTemporaryFile(
+          "instrprof-merged", "tmp", FD, ScratchPath))
+    return EC;
+
+  std::vector<std::tuple<StringRef, uint64_t, uint64_t>> Functions;
+  std::error_code EC;
+  {
+    raw_fd_ostream Scratch(FD, /*shouldClose=*/true);
+    EC = mergeSpillRuns(Readers, SpillWarn,
+                        [&](StringRef Name, ProfilingData &Data) {
+      uint64_t Start = Scratch.tell();
+      InstrProfRecordTrait::EmitData(Scratch, Name, &Data, 0);
+      Functions.push_back(
+          std::make_tuple(Name, Start, uint64_t(Scratch.tell()) - Start));
+      for (const auto &I : Data)
+        MaxFunctionCount = std::max(MaxFunctionCount, I.second.Counts[0]);
+    });
+    Scratch.close();
+    if (Scratch.has_error()) {
+      Scratch.clear_error();
+      if (!EC)
+        EC = make_error_code(errc::io_error);
+    }
+  }
+  if (EC) {
+    sys::fs::remove(ScratchPath);
+    return EC;
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> ScratchOrErr = MemoryBuffer::getFile(
+      ScratchPath, -1, /*RequiresNullTerminator=*/false);
+  sys::fs::remove(ScratchPath);
+  if ((EC = ScratchOrErr.getError()))
+    return EC;
+  StringRef Serialized = ScratchOrErr.get()->getBuffer();
+
+  OnDiskChainedHashTableGenerator<SerializedRecordTrait> Generator;
+  for (const auto &F : Functions)
+    Generator.insert(std::get<0>(F),
+                     Serialized.substr(std::get<1>(F), std::get<2>(F)));
+  writeIndexedProfile(OS, Generator, MaxFunctionCount);
+  return std::error_code();
 }
 
-void InstrProfWriter::write(raw_fd_ostream &OS) {
+std::error_code InstrProfWriter::write(raw_fd_ostream &OS) {
   // Write the hash table.
   ProfOStream POS(OS);
-  writeImpl(POS);
+  return writeImpl(POS);
 }
 
 std::unique_ptr<MemoryBuffer> InstrProfWriter::writeBuffer() {
@@ -223,7 +567,8 @@ std::unique_ptr<MemoryBuffer> InstrProfWriter::writeBuffer() {
   llvm::raw_string_ostream OS(Data);
   ProfOStream POS(OS);
   // Write the hash table.
-  writeImpl(POS);
+  if (writeImpl(POS))
+    return nullptr;
   // Return this in an aligned memory buffer.
   return MemoryBuffer::getMemBufferCopy(Data);
 }
@@ -272,13 +617,42 @@ void InstrProfWriter::writeRecordInText(const InstrProfRecord &Func,
   OS << "\n";
 }
 
-void InstrProfWriter::writeText(raw_fd_ostream &OS) {
+std::error_code InstrProfWriter::writeText(raw_fd_ostream &OS) {
   InstrProfSymtab Symtab;
-  for (const auto &I : FunctionData)
-    Symtab.addFuncName(I.getKey());
+  if (SpillFiles.empty()) {
+    for (const auto &I : FunctionData)
+      Symtab.addFuncName(I.getKey());
+    Symtab.finalizeSymtab();
+
+    for (const auto &I : FunctionData)
+      for (const auto &Func : I.getValue())
+        writeRecordInText(Func.second, Symtab, OS);
+    return std::error_code();
+  }
+
+  if (!FunctionData.empty())
+    if (std::error_code EC = spill())
+      return EC;
+
+  // Indirect call targets are printed by name, so collect the names of all
+  // the functions before merging.
+  SpillRunReaderList NameReaders;
+  if (std::error_code EC = openSpillRuns(SpillFiles, NameReaders))
+    return EC;
+  for (auto &Reader : NameReaders) {
+    while (Reader->next())
+      Symtab.addFuncName(Reader->Record.Name);
+    if (Reader->Err)
+      return Reader->Err;
+  }
   Symtab.finalizeSymtab();
 
-  for (const auto &I : FunctionData)
-    for (const auto &Func : I.getValue())
+  SpillRunReaderList Readers;
+  if (std::error_code EC = openSpillRuns(SpillFiles, Readers))
+    return EC;
+  return mergeSpillRuns(Readers, SpillWarn,
+                        [&](StringRef, ProfilingData &Data) {
+    for (const auto &Func : Data)
       writeRecordInText(Func.second, Symtab, OS);
+  });
 }
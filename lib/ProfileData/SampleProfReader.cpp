@@ -360,25 +360,80 @@ SampleProfileReaderBinary::readProfile(FunctionSamples &FProfile) {
   return sampleprof_error::success;
 }
 
+std::error_code SampleProfileReaderBinary::readFuncProfile() {
+  auto NumHeadSamples = readNumber<uint64_t>();
+  if (std::error_code EC = NumHeadSamples.getError())
+    return EC;
+
+  auto FName(readStringFromTable());
+  if (std::error_code EC = FName.getError())
+    return EC;
+
+  Profiles[*FName] = FunctionSamples();
+  FunctionSamples &FProfile = Profiles[*FName];
+
+  FProfile.addHeadSamples(*NumHeadSamples);
+
+  return readProfile(FProfile);
+}
+
 std::error_code SampleProfileReaderBinary::read() {
+  Data = FuncBodiesStart;
   while (!at_eof()) {
-    auto NumHeadSamples = readNumber<uint64_t>();
-    if (std::error_code EC = NumHeadSamples.getError())
+    if (std::error_code EC = readFuncProfile())
       return EC;
+  }
 
-    auto FName(readStringFromTable());
-    if (std::error_code EC = FName.getError())
+  return sampleprof_error::success;
+}
+
+std::error_code
+SampleProfileReaderBinary::readFunctions(ArrayRef<StringRef> FuncNames) {
+  if (!HasFuncIndex)
+    return read();
+
+  for (StringRef Name : FuncNames) {
+    auto I = FuncOffsetTable.find(Name);
+    if (I == FuncOffsetTable.end())
+      continue;
+    if (I->second >= uint64_t(End - FuncBodiesStart))
+      return sampleprof_error::malformed;
+    Data = FuncBodiesStart + I->second;
+    if (std::error_code EC = readFuncProfile())
       return EC;
+  }
 
-    Profiles[*FName] = FunctionSamples();
-    FunctionSamples &FProfile = Profiles[*FName];
+  return sampleprof_error::success;
+}
 
-    FProfile.addHeadSamples(*NumHeadSamples);
+uint64_t SampleProfileReaderBinary::getTotalSamples() {
+  if (!HasFuncIndex)
+    return SampleProfileReader::getTotalSamples();
+  return TotalSamples;
+}
 
-    if (std::error_code EC = readProfile(FProfile))
+std::error_code SampleProfileReaderBinary::readFuncIndex() {
+  auto Total = readNumber<uint64_t>();
+  if (std::error_code EC = Total.getError())
+    return EC;
+  TotalSamples = *Total;
+
+  auto Size = readNumber<uint32_t>();
+  if (std::error_code EC = Size.getError())
+    return EC;
+  for (uint32_t I = 0; I < *Size; ++I) {
+    auto FName(readStringFromTable());
+    if (std::error_code EC = FName.getError())
+      return EC;
+
+    auto Offset = readNumber<uint64_t>();
+    if (std::error_code EC = Offset.getError())
       return EC;
+
+    FuncOffsetTable[*FName] = *Offset;
   }
 
+  HasFuncIndex = true;
   return sampleprof_error::success;
 }
 
@@ -397,7 +452,7 @@ std::error_code SampleProfileReaderBinary::readHeader() {
   auto Version = readNumber<uint64_t>();
   if (std::error_code EC = Version.getError())
     return EC;
-  else if (*Version != SPVersion())
+  else if (*Version != SPVersion() && *Version != SPVersionNoIndex())
     return sampleprof_error::unsupported_version;
 
   // Read the name table.
@@ -412,6 +467,11 @@ std::error_code SampleProfileReaderBinary::readHeader() {
     NameTable.push_back(*Name);
   }
 
+  if (*Version != SPVersionNoIndex())
+    if (std::error_code EC = readFuncIndex())
+      return EC;
+
+  FuncBodiesStart = Data;
   return sampleprof_error::success;
 }
 
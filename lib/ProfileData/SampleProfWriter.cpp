@@ -23,6 +23,7 @@
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Regex.h"
 
@@ -82,11 +83,12 @@ std::error_code SampleProfileWriterText::write(StringRef FName,
   return sampleprof_error::success;
 }
 
-std::error_code SampleProfileWriterBinary::writeNameIdx(StringRef FName) {
+std::error_code SampleProfileWriterBinary::writeNameIdx(raw_ostream &OS,
+                                                        StringRef FName) {
   const auto &ret = NameTable.find(FName);
   if (ret == NameTable.end())
     return sampleprof_error::truncated_name_table;
-  encodeULEB128(ret->second, *OutputStream);
+  encodeULEB128(ret->second, OS);
   return sampleprof_error::success;
 }
 
@@ -136,11 +138,10 @@ std::error_code SampleProfileWriterBinary::writeHeader(
   return sampleprof_error::success;
 }
 
-std::error_code SampleProfileWriterBinary::writeBody(StringRef FName,
+std::error_code SampleProfileWriterBinary::writeBody(raw_ostream &OS,
+                                                     StringRef FName,
                                                      const FunctionSamples &S) {
-  auto &OS = *OutputStream;
-
-  if (std::error_code EC = writeNameIdx(FName))
+  if (std::error_code EC = writeNameIdx(OS, FName))
     return EC;
 
   encodeULEB128(S.getTotalSamples(), OS);
@@ -157,7 +158,7 @@ std::error_code SampleProfileWriterBinary::writeBody(StringRef FName,
     for (const auto &J : Sample.getCallTargets()) {
       StringRef Callee = J.first();
       uint64_t CalleeSamples = J.second;
-      if (std::error_code EC = writeNameIdx(Callee))
+      if (std::error_code EC = writeNameIdx(OS, Callee))
         return EC;
       encodeULEB128(CalleeSamples, OS);
     }
@@ -170,7 +171,7 @@ std::error_code SampleProfileWriterBinary::writeBody(StringRef FName,
     const FunctionSamples &CalleeSamples = J.second;
     encodeULEB128(Loc.LineOffset, OS);
     encodeULEB128(Loc.Discriminator, OS);
-    if (std::error_code EC = writeBody(Loc.CalleeName, CalleeSamples))
+    if (std::error_code EC = writeBody(OS, Loc.CalleeName, CalleeSamples))
       return EC;
   }
 
@@ -183,7 +184,44 @@ std::error_code SampleProfileWriterBinary::writeBody(StringRef FName,
 std::error_code SampleProfileWriterBinary::write(StringRef FName,
                                                  const FunctionSamples &S) {
   encodeULEB128(S.getHeadSamples(), *OutputStream);
-  return writeBody(FName, S);
+  return writeBody(*OutputStream, FName, S);
+}
+
+/// \brief Write all the profiles in \p ProfileMap to a binary file.
+///
+/// The function bodies are encoded into a buffer first, so that the index
+/// written in front of them can record where each one starts.
+std::error_code SampleProfileWriterBinary::write(
+    const StringMap<FunctionSamples> &ProfileMap) {
+  if (std::error_code EC = writeHeader(ProfileMap))
+    return EC;
+
+  std::string Bodies;
+  raw_string_ostream BodiesOS(Bodies);
+  std::vector<std::pair<StringRef, uint64_t>> FuncOffsets;
+  uint64_t TotalSamples = 0;
+  for (const auto &I : ProfileMap) {
+    StringRef FName = I.first();
+    const FunctionSamples &Profile = I.second;
+    FuncOffsets.emplace_back(FName, BodiesOS.tell());
+    encodeULEB128(Profile.getHeadSamples(), BodiesOS);
+    if (std::error_code EC = writeBody(BodiesOS, FName, Profile))
+      return EC;
+    TotalSamples = SaturatingAdd(TotalSamples, Profile.getTotalSamples());
+  }
+  BodiesOS.flush();
+
+  auto &OS = *OutputStream;
+  encodeULEB128(TotalSamples, OS);
+  encodeULEB128(FuncOffsets.size(), OS);
+  for (const auto &I : FuncOffsets) {
+    if (std::error_code EC = writeNameIdx(OS, I.first))
+      return EC;
+    encodeULEB128(I.second, OS);
+  }
+  OS << Bodies;
+
+  return sampleprof_error::success;
 }
 
 /// \brief Create a sample profile file writer based on the specified format.
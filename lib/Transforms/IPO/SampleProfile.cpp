@@ -1228,7 +1228,15 @@ bool SampleProfileLoader::doInitialization(Module &M) {
     return false;
   }
   Reader = std::move(ReaderOrErr.get());
-  ProfileIsValid = (Reader->read() == sampleprof_error::success);
+
+  // Only the profiles of the functions defined in this module are needed, so
+  // let readers that can seek to individual functions skip the rest.
+  std::vector<StringRef> FuncNames;
+  for (const auto &F : M)
+    if (!F.isDeclaration())
+      FuncNames.push_back(F.getName());
+  ProfileIsValid =
+      (Reader->readFunctions(FuncNames) == sampleprof_error::success);
   return true;
 }
 
@@ -1245,8 +1253,7 @@ bool SampleProfileLoader::runOnModule(Module &M) {
     return false;
 
   // Compute the total number of samples collected in this profile.
-  for (const auto &I : Reader->getProfiles())
-    TotalCollectedSamples += I.second.getTotalSamples();
+  TotalCollectedSamples = Reader->getTotalSamples();
 
   bool retval = false;
   for (auto &F : M)
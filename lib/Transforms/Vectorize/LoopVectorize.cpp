@@ -94,6 +94,8 @@
 #include "llvm/Support/BranchProbability.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
@@ -114,6 +116,15 @@ using namespace llvm::PatternMatch;
 STATISTIC(LoopsVectorized, "Number of loops vectorized");
 STATISTIC(LoopsAnalyzed, "Number of loops analyzed for vectorization");
 
+/// Name of the timer group used to break down the time spent in the loop
+/// vectorizer when -time-passes is given.
+static const char *const LVTimerGroupName = "Loop Vectorizer";
+
+static cl::opt<bool> ReportLoopTimes(
+    "vectorizer-report-loop-times", cl::init(false), cl::Hidden,
+    cl::desc("Report the time spent on legality analysis, cost modeling and "
+             "code generation for each loop as an analysis remark."));
+
 static cl::opt<bool>
 EnableIfConversion("enable-if-conversion", cl::init(true), cl::Hidden,
                    cl::desc("Enable if-conversion during vectorization."));
@@ -1471,9 +1482,13 @@ private:
   /// Returns the expected execution cost. The unit of the cost does
   /// not matter because we use the 'cost' units to compare different
   /// vector widths. The cost that is returned is *not* normalized by
-  /// the factor width.
+  /// the factor width. The result is memoized per VF.
   unsigned expectedCost(unsigned VF);
 
+  /// Computes the expected execution cost for a VF without consulting the
+  /// ExpectedCosts cache.
+  unsigned computeExpectedCost(unsigned VF);
+
   /// Returns the execution time cost of an instruction for a given vector
   /// width. Vector width of one means scalar.
   unsigned getInstructionCost(Instruction *I, unsigned VF);
@@ -1519,6 +1534,10 @@ public:
   SmallPtrSet<const Value *, 16> ValuesToIgnore;
   /// Values to ignore in the cost model when VF > 1.
   SmallPtrSet<const Value *, 16> VecValuesToIgnore;
+  /// The loop costs computed so far, indexed by VF. Selecting the
+  /// vectorization factor and the interleave count may ask for the same VF
+  /// more than once.
+  SmallDenseMap<unsigned, unsigned, 8> ExpectedCosts;
 };
 
 /// \brief This holds vectorization requirements that must be verified late in
@@ -1588,6 +1607,67 @@ static void addInnerLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
     addInnerLoop(*InnerL, V);
 }
 
+/// Times the phases of the vectorizer for one loop. Every phase is charged to
+/// the -time-passes timer group, which only has totals over all loops. With
+/// -vectorizer-report-loop-times the times for this loop are also reported in
+/// an analysis remark at the loop's location once it has been processed.
+class LoopPhaseTimer {
+public:
+  enum Phase { Legality, CostModel, CodeGen, NumPhases };
+
+  /// Charges the time until it goes out of scope to one phase.
+  class Region {
+    NamedRegionTimer T;
+    TimeRecord *Total;
+    TimeRecord Start;
+
+  public:
+    Region(LoopPhaseTimer &LPT, Phase P)
+        : T(getPhaseName(P), LVTimerGroupName, TimePassesIsEnabled),
+          Total(ReportLoopTimes ? &LPT.Times[P] : nullptr) {
+      if (Total)
+        Start = TimeRecord::getCurrentTime(true);
+    }
+    ~Region() {
+      if (!Total)
+        return;
+      TimeRecord Elapsed = TimeRecord::getCurrentTime(false);
+      Elapsed -= Start;
+      *Total += Elapsed;
+    }
+  };
+
+  LoopPhaseTimer(Function *F, Loop *L) : F(F), L(L) {}
+
+  ~LoopPhaseTimer() {
+    if (!ReportLoopTimes)
+      return;
+    std::string Msg;
+    raw_string_ostream OS(Msg);
+    OS << "vectorizer time:";
+    for (unsigned P = 0; P != NumPhases; ++P)
+      OS << (P ? ", " : " ") << getPhaseName(Phase(P)) << " "
+         << format("%.6f", Times[P].getWallTime()) << "s";
+    emitOptimizationRemarkAnalysis(F->getContext(), LV_NAME, *F,
+                                   L->getStartLoc(), OS.str());
+  }
+
+private:
+  static const char *getPhaseName(Phase P) {
+    switch (P) {
+    case Legality:  return "Legality Analysis";
+    case CostModel: return "Cost Modeling";
+    case CodeGen:   return "Code Generation";
+    case NumPhases: break;
+    }
+    llvm_unreachable("Unknown vectorizer phase");
+  }
+
+  Function *F;
+  Loop *L;
+  TimeRecord Times[NumPhases];
+};
+
 /// The LoopVectorize Pass.
 struct LoopVectorize : public FunctionPass {
   /// Pass identification, replacement for typeid
@@ -1752,12 +1832,18 @@ struct LoopVectorize : public FunctionPass {
     }
 
     PredicatedScalarEvolution PSE(*SE);
+    LoopPhaseTimer Timer(F, L);
 
     // Check if it is legal to vectorize the loop.
     LoopVectorizationRequirements Requirements;
     LoopVectorizationLegality LVL(L, PSE, DT, TLI, AA, F, TTI, LAA,
                                   &Requirements, &Hints);
-    if (!LVL.canVectorize()) {
+    bool CanVectorize;
+    {
+      LoopPhaseTimer::Region T(Timer, LoopPhaseTimer::Legality);
+      CanVectorize = LVL.canVectorize();
+    }
+    if (!CanVectorize) {
       DEBUG(dbgs() << "LV: Not vectorizing: Cannot prove legality.\n");
       emitMissedWarning(F, L, Hints);
       return false;
@@ -1766,7 +1852,10 @@ struct LoopVectorize : public FunctionPass {
     // Use the cost model.
     LoopVectorizationCostModel CM(L, PSE, LI, &LVL, *TTI, TLI, DB, AC, F,
                                   &Hints);
-    CM.collectValuesToIgnore();
+    {
+      LoopPhaseTimer::Region T(Timer, LoopPhaseTimer::CostModel);
+      CM.collectValuesToIgnore();
+    }
 
     // Check the function attributes to find out if this function should be
     // optimized for size.
@@ -1800,12 +1889,16 @@ struct LoopVectorize : public FunctionPass {
       return false;
     }
 
-    // Select the optimal vectorization factor.
-    const LoopVectorizationCostModel::VectorizationFactor VF =
-        CM.selectVectorizationFactor(OptForSize);
+    LoopVectorizationCostModel::VectorizationFactor VF;
+    unsigned IC;
+    {
+      LoopPhaseTimer::Region T(Timer, LoopPhaseTimer::CostModel);
+      // Select the optimal vectorization factor.
+      VF = CM.selectVectorizationFactor(OptForSize);
 
-    // Select the interleave count.
-    unsigned IC = CM.selectInterleaveCount(OptForSize, VF.Width, VF.Cost);
+      // Select the interleave count.
+      IC = CM.selectInterleaveCount(OptForSize, VF.Width, VF.Cost);
+    }
 
     // Get user interleave count.
     unsigned UserIC = Hints.getInterleave();
@@ -1878,7 +1971,10 @@ struct LoopVectorize : public FunctionPass {
       // If we decided that it is not legal to vectorize the loop then
       // interleave it.
       InnerLoopUnroller Unroller(L, PSE, LI, DT, TLI, TTI, IC);
-      Unroller.vectorize(&LVL, CM.MinBWs);
+      {
+        LoopPhaseTimer::Region T(Timer, LoopPhaseTimer::CodeGen);
+        Unroller.vectorize(&LVL, CM.MinBWs);
+      }
 
       emitOptimizationRemark(F->getContext(), LV_NAME, *F, L->getStartLoc(),
                              Twine("interleaved loop (interleaved count: ") +
@@ -1886,7 +1982,10 @@ struct LoopVectorize : public FunctionPass {
     } else {
       // If we decided that it is *legal* to vectorize the loop then do it.
       InnerLoopVectorizer LB(L, PSE, LI, DT, TLI, TTI, VF.Width, IC);
-      LB.vectorize(&LVL, CM.MinBWs);
+      {
+        LoopPhaseTimer::Region T(Timer, LoopPhaseTimer::CodeGen);
+        LB.vectorize(&LVL, CM.MinBWs);
+      }
       ++LoopsVectorized;
 
       // Add metadata to disable runtime unrolling scalar loop when there's no
@@ -5221,6 +5320,16 @@ LoopVectorizationCostModel::calculateRegisterUsage(
 }
 
 unsigned LoopVectorizationCostModel::expectedCost(unsigned VF) {
+  auto CostIt = ExpectedCosts.find(VF);
+  if (CostIt != ExpectedCosts.end())
+    return CostIt->second;
+
+  unsigned Cost = computeExpectedCost(VF);
+  ExpectedCosts[VF] = Cost;
+  return Cost;
+}
+
+unsigned LoopVectorizationCostModel::computeExpectedCost(unsigned VF) {
   unsigned Cost = 0;
 
   // For each block.
@@ -55,6 +55,8 @@ using namespace llvm;
 #define DEBUG_TYPE "SLP"
 
 STATISTIC(NumVectorInstructions, "Number of vector instructions generated");
+STATISTIC(NumReusedScheduleRegions,
+          "Number of scheduling regions reused from a previous tree");
 
 static cl::opt<int>
     SLPCostThreshold("slp-threshold", cl::init(0), cl::Hidden,
@@ -397,7 +399,15 @@ public:
     NumLoadsWantToChangeOrder = 0;
     for (auto &Iter : BlocksSchedules) {
       BlockScheduling *BS = Iter.second.get();
-      BS->clear();
+      // Nothing to do if the last tree didn't touch a retained region.
+      if (BS->IsRetainedRegion)
+        continue;
+      // The IR is unchanged since the region was built unless the tree was
+      // vectorized (which resets the region), so keep it for the next tree.
+      if (BS->ScheduleStart)
+        BS->releaseBundles();
+      else
+        BS->clear();
     }
   }
 
@@ -742,9 +752,10 @@ private:
           ScheduleRegionSizeLimit(ScheduleRegionSizeBudget),
           // Make sure that the initial SchedulingRegionID is greater than the
           // initial SchedulingRegionID in ScheduleData (which is 0).
-          SchedulingRegionID(1) {}
+          SchedulingRegionID(1), IsRetainedRegion(false) {}
 
     void clear() {
+      IsRetainedRegion = false;
       ReadyInsts.clear();
       ScheduleStart = nullptr;
       ScheduleEnd = nullptr;
@@ -851,6 +862,11 @@ private:
     /// Sets all instruction in the scheduling region to un-scheduled.
     void resetSchedule();
 
+    /// Dissolves all bundles and resets the schedule, but keeps the
+    /// scheduling region and its dependencies. This is only valid as long as
+    /// the IR in the region has not changed.
+    void releaseBundles();
+
     BasicBlock *BB;
 
     /// Simple memory allocation for ScheduleData.
@@ -898,6 +914,12 @@ private:
     /// The ID of the scheduling region. For a new vectorization iteration this
     /// is incremented which "removes" all ScheduleData from the region.
     int SchedulingRegionID;
+
+    /// True if the region was kept from a previous tree by releaseBundles()
+    /// and no bundle of the current tree was scheduled in it yet. The first
+    /// bundle of the new tree reuses the region if it lies within it, which
+    /// saves searching the block and recalculating the dependencies.
+    bool IsRetainedRegion;
   };
 
   /// Attaches the BlockScheduling structures to basic blocks.
@@ -2561,8 +2583,14 @@ Value *BoUpSLP::vectorizeTree(TreeEntry *E) {
 Value *BoUpSLP::vectorizeTree() {
 
   // All blocks must be scheduled before any instructions are inserted.
+  // Regions retained from previous trees and not used by this one are
+  // dropped, as vectorization is about to change the IR.
   for (auto &BSIter : BlocksSchedules) {
-    scheduleBlock(BSIter.second.get());
+    BlockScheduling *BS = BSIter.second.get();
+    if (BS->IsRetainedRegion)
+      BS->clear();
+    else
+      scheduleBlock(BS);
   }
 
   Builder.SetInsertPoint(&F->getEntryBlock().front());
@@ -2753,6 +2781,18 @@ bool BoUpSLP::BlockScheduling::tryScheduleBundle(ArrayRef<Value *> VL,
   if (isa<PHINode>(VL[0]))
     return true;
 
+  if (IsRetainedRegion) {
+    // Only reuse the region of a previous tree if it already contains the
+    // first bundle of this tree. Otherwise start from scratch, so that we
+    // don't extend a region that may be far away from this tree.
+    IsRetainedRegion = false;
+    if (std::all_of(VL.begin(), VL.end(),
+                    [this](Value *V) { return getScheduleData(V); }))
+      ++NumReusedScheduleRegions;
+    else
+      clear();
+  }
+
   // Initialize the instruction bundle.
   Instruction *OldScheduleEnd = ScheduleEnd;
   ScheduleData *PrevInBundle = nullptr;
@@ -3079,6 +3119,19 @@ void BoUpSLP::BlockScheduling::resetSchedule() {
   ReadyInsts.clear();
 }
 
+void BoUpSLP::BlockScheduling::releaseBundles() {
+  assert(ScheduleStart && "tried to release bundles of an empty region");
+  for (Instruction *I = ScheduleStart; I != ScheduleEnd; I = I->getNextNode()) {
+    ScheduleData *SD = getScheduleData(I);
+    SD->FirstInBundle = SD;
+    SD->NextInBundle = nullptr;
+    SD->UnscheduledDepsInBundle = SD->UnscheduledDeps;
+  }
+  resetSchedule();
+  initialFillReadyList(ReadyInsts);
+  IsRetainedRegion = true;
+}
+
 void BoUpSLP::scheduleBlock(BlockScheduling *BS) {
 
   if (!BS->ScheduleStart)
@@ -0,0 +1,113 @@
+; RUN: opt < %s -basicaa -aa-eval -print-all-alias-modref-info -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -basicaa -aa-eval -disable-output -stats 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; BasicAA caches GEP decompositions for the lifetime of its result. Every GEP
+; below takes part in many aa-eval queries, so all but the first
+; decomposition of each should come from the cache, and the alias results
+; must be the same as without the cache.
+
+; STATS: {{[1-9][0-9]*}} basicaa {{.*}} Number of GEP decompositions reused from the cache
+
+; CHECK: Function: gep_heavy: 12 pointers, 0 call sites
+; CHECK-NEXT: NoAlias: [16 x i32]* %a, [16 x i32]* %b
+; CHECK-NEXT: MustAlias: [16 x i32]* %a, i32* %a0
+; CHECK-NEXT: NoAlias: [16 x i32]* %b, i32* %a0
+; CHECK-NEXT: PartialAlias: [16 x i32]* %a, i32* %a1
+; CHECK-NEXT: NoAlias: [16 x i32]* %b, i32* %a1
+; CHECK-NEXT: NoAlias: i32* %a0, i32* %a1
+; CHECK-NEXT: PartialAlias: [16 x i32]* %a, i32* %a2
+; CHECK-NEXT: NoAlias: [16 x i32]* %b, i32* %a2
+; CHECK-NEXT: NoAlias: i32* %a0, i32* %a2
+; CHECK-NEXT: NoAlias: i32* %a1, i32* %a2
+; CHECK-NEXT: PartialAlias: [16 x i32]* %a, i32* %ai
+; CHECK-NEXT: NoAlias: [16 x i32]* %b, i32* %ai
+; CHECK-NEXT: PartialAlias: i32* %a0, i32* %ai
+; CHECK-NEXT: PartialAlias: i32* %a1, i32* %ai
+; CHECK-NEXT: PartialAlias: i32* %a2, i32* %ai
+; CHECK-NEXT: PartialAlias: [16 x i32]* %a, i32* %ai1
+; CHECK-NEXT: NoAlias: [16 x i32]* %b, i32* %ai1
+; CHECK-NEXT: PartialAlias: i32* %a0, i32* %ai1
+; CHECK-NEXT: PartialAlias: i32* %a1, i32* %ai1
+; CHECK-NEXT: PartialAlias: i32* %a2, i32* %ai1
+; CHECK-NEXT: NoAlias: i32* %ai, i32* %ai1
+; CHECK-NEXT: PartialAlias: [16 x i32]* %a, i32* %aj
+; CHECK-NEXT: NoAlias: [16 x i32]* %b, i32* %aj
+; CHECK-NEXT: PartialAlias: i32* %a0, i32* %aj
+; CHECK-NEXT: PartialAlias: i32* %a1, i32* %aj
+; CHECK-NEXT: PartialAlias: i32* %a2, i32* %aj
+; CHECK-NEXT: PartialAlias: i32* %ai, i32* %aj
+; CHECK-NEXT: PartialAlias: i32* %ai1, i32* %aj
+; CHECK-NEXT: NoAlias: [16 x i32]* %a, i32* %b0
+; CHECK-NEXT: MustAlias: [16 x i32]* %b, i32* %b0
+; CHECK-NEXT: NoAlias: i32* %a0, i32* %b0
+; CHECK-NEXT: NoAlias: i32* %a1, i32* %b0
+; CHECK-NEXT: NoAlias: i32* %a2, i32* %b0
+; CHECK-NEXT: NoAlias: i32* %ai, i32* %b0
+; CHECK-NEXT: NoAlias: i32* %ai1, i32* %b0
+; CHECK-NEXT: NoAlias: i32* %aj, i32* %b0
+; CHECK-NEXT: NoAlias: [16 x i32]* %a, i32* %bi
+; CHECK-NEXT: PartialAlias: [16 x i32]* %b, i32* %bi
+; CHECK-NEXT: NoAlias: i32* %a0, i32* %bi
+; CHECK-NEXT: NoAlias: i32* %a1, i32* %bi
+; CHECK-NEXT: NoAlias: i32* %a2, i32* %bi
+; CHECK-NEXT: NoAlias: i32* %ai, i32* %bi
+; CHECK-NEXT: NoAlias: i32* %ai1, i32* %bi
+; CHECK-NEXT: NoAlias: i32* %aj, i32* %bi
+; CHECK-NEXT: PartialAlias: i32* %b0, i32* %bi
+; CHECK-NEXT: PartialAlias: [16 x i32]* %a, i32* %sel
+; CHECK-NEXT: NoAlias: [16 x i32]* %b, i32* %sel
+; CHECK-NEXT: NoAlias: i32* %a0, i32* %sel
+; CHECK-NEXT: PartialAlias: i32* %a1, i32* %sel
+; CHECK-NEXT: PartialAlias: i32* %a2, i32* %sel
+; CHECK-NEXT: PartialAlias: i32* %ai, i32* %sel
+; CHECK-NEXT: PartialAlias: i32* %ai1, i32* %sel
+; CHECK-NEXT: PartialAlias: i32* %aj, i32* %sel
+; CHECK-NEXT: NoAlias: i32* %b0, i32* %sel
+; CHECK-NEXT: NoAlias: i32* %bi, i32* %sel
+; CHECK-NEXT: PartialAlias: [16 x i32]* %a, i32* %phi
+; CHECK-NEXT: NoAlias: [16 x i32]* %b, i32* %phi
+; CHECK-NEXT: PartialAlias: i32* %a0, i32* %phi
+; CHECK-NEXT: PartialAlias: i32* %a1, i32* %phi
+; CHECK-NEXT: PartialAlias: i32* %a2, i32* %phi
+; CHECK-NEXT: PartialAlias: i32* %ai, i32* %phi
+; CHECK-NEXT: PartialAlias: i32* %ai1, i32* %phi
+; CHECK-NEXT: PartialAlias: i32* %aj, i32* %phi
+; CHECK-NEXT: NoAlias: i32* %b0, i32* %phi
+; CHECK-NEXT: NoAlias: i32* %bi, i32* %phi
+; CHECK-NEXT: PartialAlias: i32* %phi, i32* %sel
+
+define void @gep_heavy([16 x i32]* noalias %a, [16 x i32]* noalias %b, i64 %i, i64 %j, i1 %c) {
+entry:
+  %a0 = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 0
+  %a1 = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 1
+  %a2 = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 2
+  %ai = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 %i
+  %i1 = add nsw i64 %i, 1
+  %ai1 = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 %i1
+  %aj = getelementptr inbounds [16 x i32], [16 x i32]* %a, i64 0, i64 %j
+  %b0 = getelementptr inbounds [16 x i32], [16 x i32]* %b, i64 0, i64 0
+  %bi = getelementptr inbounds [16 x i32], [16 x i32]* %b, i64 0, i64 %i
+  %sel = select i1 %c, i32* %a1, i32* %a2
+  br i1 %c, label %left, label %right
+
+left:
+  br label %join
+
+right:
+  br label %join
+
+join:
+  %phi = phi i32* [ %ai, %left ], [ %ai1, %right ]
+  store i32 0, i32* %a0
+  store i32 1, i32* %a1
+  store i32 2, i32* %a2
+  store i32 3, i32* %ai
+  store i32 4, i32* %ai1
+  store i32 5, i32* %aj
+  store i32 6, i32* %b0
+  store i32 7, i32* %bi
+  store i32 8, i32* %sel
+  store i32 9, i32* %phi
+  ret void
+}
@@ -0,0 +1,80 @@
+# A compile unit with an "outer" subprogram whose address range contains the
+# range of a nested "inner" subprogram, and an "after" subprogram that starts
+# where "outer" ends.
+#
+# Build as:
+#   as nested-subprograms.s -o nested-subprograms.o
+#   ld -e 0 -Ttext=0x400000 nested-subprograms.o \
+#     -o nested-subprograms.elf-x86-64
+
+	.text
+.Lbegin:
+.Louter:
+	.fill	16, 1, 0x90
+.Linner:
+	.fill	16, 1, 0x90
+.Linner_end:
+	.fill	16, 1, 0x90
+.Louter_end:
+.Lafter:
+	.fill	16, 1, 0x90
+.Lafter_end:
+
+	.section	.debug_abbrev,"",@progbits
+	.uleb128 1		# Abbreviation code
+	.uleb128 0x11		# DW_TAG_compile_unit
+	.byte	1		# DW_CHILDREN_yes
+	.uleb128 0x03		# DW_AT_name
+	.uleb128 0x08		# DW_FORM_string
+	.uleb128 0x11		# DW_AT_low_pc
+	.uleb128 0x01		# DW_FORM_addr
+	.uleb128 0x12		# DW_AT_high_pc
+	.uleb128 0x07		# DW_FORM_data8
+	.byte	0, 0
+	.uleb128 2		# Abbreviation code
+	.uleb128 0x2e		# DW_TAG_subprogram
+	.byte	1		# DW_CHILDREN_yes
+	.uleb128 0x03		# DW_AT_name
+	.uleb128 0x08		# DW_FORM_string
+	.uleb128 0x11		# DW_AT_low_pc
+	.uleb128 0x01		# DW_FORM_addr
+	.uleb128 0x12		# DW_AT_high_pc
+	.uleb128 0x07		# DW_FORM_data8
+	.byte	0, 0
+	.uleb128 3		# Abbreviation code
+	.uleb128 0x2e		# DW_TAG_subprogram
+	.byte	0		# DW_CHILDREN_no
+	.uleb128 0x03		# DW_AT_name
+	.uleb128 0x08		# DW_FORM_string
+	.uleb128 0x11		# DW_AT_low_pc
+	.uleb128 0x01		# DW_FORM_addr
+	.uleb128 0x12		# DW_AT_high_pc
+	.uleb128 0x07		# DW_FORM_data8
+	.byte	0, 0
+	.byte	0
+
+	.section	.debug_info,"",@progbits
+	.long	.Linfo_end - .Linfo_start	# Length of unit
+.Linfo_start:
+	.short	4			# DWARF version
+	.long	0			# Abbrev offset
+	.byte	8			# Address size
+	.uleb128 1			# DW_TAG_compile_unit
+	.asciz	"nested-subprograms.s"
+	.quad	.Lbegin
+	.quad	.Lafter_end - .Lbegin
+	.uleb128 2			# DW_TAG_subprogram
+	.asciz	"outer"
+	.quad	.Louter
+	.quad	.Louter_end - .Louter
+	.uleb128 3			#   DW_TAG_subprogram
+	.asciz	"inner"
+	.quad	.Linner
+	.quad	.Linner_end - .Linner
+	.byte	0			# End of outer's children
+	.uleb128 3			# DW_TAG_subprogram
+	.asciz	"after"
+	.quad	.Lafter
+	.quad	.Lafter_end - .Lafter
+	.byte	0			# End of the unit's children
+.Linfo_end:
@@ -0,0 +1,37 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-inline-stubs=false -orc-lazy-debug=funcs-to-stdout %s | FileCheck %s --check-prefix=LAZY
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-inline-stubs=false -orc-lazy-speculate-callees -orc-lazy-debug=funcs-to-stdout %s | FileCheck %s --check-prefix=SPEC
+;
+; By default each function gets its own partition when it is first called.
+; LAZY: [ main ]
+; LAZY: [ foo ]
+; LAZY: [ bar ]
+;
+; With speculation @foo is compiled along with @main, and the calls to it go
+; straight through its repointed stub rather than compiling it again. @bar is
+; only called from @foo, so it is still compiled on its first call.
+; SPEC: [ {{(main foo|foo main)}} ]
+; SPEC-NOT: [ foo ]
+; SPEC: [ bar ]
+; SPEC-NOT: [ foo ]
+
+define i32 @bar() {
+entry:
+  ret i32 2
+}
+
+define i32 @foo() {
+entry:
+  %b = call i32 @bar()
+  %r = add i32 %b, 1
+  ret i32 %r
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  %a = call i32 @foo()
+  %b = call i32 @foo()
+  %sum = add i32 %a, %b
+  %ok = icmp eq i32 %sum, 6
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
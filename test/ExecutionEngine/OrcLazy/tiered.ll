@@ -0,0 +1,46 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-tiered -orc-lazy-hot-threshold=3 %s
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-tiered -orc-lazy-hot-threshold=3 \
+; RUN:   -debug-only=orc-lazy-jit %s 2>&1 | FileCheck %s
+;
+; The instrumented partitions must be the same on every run so that their
+; objects can be cached: a second run adds nothing to the cache.
+; RUN: rm -rf %t.cache
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-tiered -orc-lazy-hot-threshold=3 \
+; RUN:   -orc-lazy-object-cache-dir=%t.cache %s
+; RUN: ls %t.cache > %t.first
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-tiered -orc-lazy-hot-threshold=3 \
+; RUN:   -orc-lazy-object-cache-dir=%t.cache %s
+; RUN: ls %t.cache | diff %t.first -
+;
+; REQUIRES: asserts
+;
+; Call @add past the hot threshold so that it is recompiled mid-loop, and
+; check that the calls after the switch still compute the right result.
+; @main is only called once, so it is never recompiled.
+; CHECK: Recompiled hot partition
+; CHECK-NEXT: Repointed add at its hot body
+; CHECK-NOT: Recompiled hot partition
+
+define i32 @add(i32 %a, i32 %b) {
+entry:
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %sum.next = call i32 @add(i32 %sum, i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 10
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %ok = icmp eq i32 %sum.next, 45
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
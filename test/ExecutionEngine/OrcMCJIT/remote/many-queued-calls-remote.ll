@@ -0,0 +1,128 @@
+; RUN: %lli -jit-kind=orc-mcjit -remote-mcjit -debug-only=orc-remote \
+; RUN:   -mcjit-remote-process=lli-child-target%exeext %s 2>&1 | FileCheck %s
+; REQUIRES: asserts
+; XFAIL: mingw32,win32
+
+; Every global below is placed in a section of its own, so finalizing the
+; object queues a long run of WriteMem and SetProtections calls, none of
+; which gets a reply. @big is larger than the channel's buffer and the pipe
+; behind it. The call of main that follows has to flush all of them in
+; order and then wait for its own reply; main only returns 0 if every byte
+; arrived.
+
+; CHECK: Allocator {{[0-9]+}} finalizing:
+; CHECK: copying rw-data: {{.*}} (262144 bytes)
+; CHECK: copying rw-data: {{.*}} (4 bytes)
+; CHECK: setting RW- permissions on rw-data block
+; CHECK: Calling int(*)(void)
+; CHECK-NEXT: Result: 0
+
+@g0 = global i32 1, section ".data.g0", align 4
+@g1 = global i32 2, section ".data.g1", align 4
+@g2 = global i32 3, section ".data.g2", align 4
+@g3 = global i32 4, section ".data.g3", align 4
+@g4 = global i32 5, section ".data.g4", align 4
+@g5 = global i32 6, section ".data.g5", align 4
+@g6 = global i32 7, section ".data.g6", align 4
+@g7 = global i32 8, section ".data.g7", align 4
+@g8 = global i32 9, section ".data.g8", align 4
+@g9 = global i32 10, section ".data.g9", align 4
+@g10 = global i32 11, section ".data.g10", align 4
+@g11 = global i32 12, section ".data.g11", align 4
+@g12 = global i32 13, section ".data.g12", align 4
+@g13 = global i32 14, section ".data.g13", align 4
+@g14 = global i32 15, section ".data.g14", align 4
+@g15 = global i32 16, section ".data.g15", align 4
+@g16 = global i32 17, section ".data.g16", align 4
+@g17 = global i32 18, section ".data.g17", align 4
+@g18 = global i32 19, section ".data.g18", align 4
+@g19 = global i32 20, section ".data.g19", align 4
+@g20 = global i32 21, section ".data.g20", align 4
+@g21 = global i32 22, section ".data.g21", align 4
+@g22 = global i32 23, section ".data.g22", align 4
+@g23 = global i32 24, section ".data.g23", align 4
+@g24 = global i32 25, section ".data.g24", align 4
+@g25 = global i32 26, section ".data.g25", align 4
+@g26 = global i32 27, section ".data.g26", align 4
+@g27 = global i32 28, section ".data.g27", align 4
+@g28 = global i32 29, section ".data.g28", align 4
+@g29 = global i32 30, section ".data.g29", align 4
+@g30 = global i32 31, section ".data.g30", align 4
+@g31 = global i32 32, section ".data.g31", align 4
+@big = global [65536 x i32] zeroinitializer, section ".data.big", align 16
+
+define i32 @main() nounwind {
+entry:
+  %last = getelementptr [65536 x i32], [65536 x i32]* @big, i64 0, i64 65535
+  store i32 7, i32* %last
+  %v0 = load i32, i32* @g0
+  %s0 = add i32 0, %v0
+  %v1 = load i32, i32* @g1
+  %s1 = add i32 %s0, %v1
+  %v2 = load i32, i32* @g2
+  %s2 = add i32 %s1, %v2
+  %v3 = load i32, i32* @g3
+  %s3 = add i32 %s2, %v3
+  %v4 = load i32, i32* @g4
+  %s4 = add i32 %s3, %v4
+  %v5 = load i32, i32* @g5
+  %s5 = add i32 %s4, %v5
+  %v6 = load i32, i32* @g6
+  %s6 = add i32 %s5, %v6
+  %v7 = load i32, i32* @g7
+  %s7 = add i32 %s6, %v7
+  %v8 = load i32, i32* @g8
+  %s8 = add i32 %s7, %v8
+  %v9 = load i32, i32* @g9
+  %s9 = add i32 %s8, %v9
+  %v10 = load i32, i32* @g10
+  %s10 = add i32 %s9, %v10
+  %v11 = load i32, i32* @g11
+  %s11 = add i32 %s10, %v11
+  %v12 = load i32, i32* @g12
+  %s12 = add i32 %s11, %v12
+  %v13 = load i32, i32* @g13
+  %s13 = add i32 %s12, %v13
+  %v14 = load i32, i32* @g14
+  %s14 = add i32 %s13, %v14
+  %v15 = load i32, i32* @g15
+  %s15 = add i32 %s14, %v15
+  %v16 = load i32, i32* @g16
+  %s16 = add i32 %s15, %v16
+  %v17 = load i32, i32* @g17
+  %s17 = add i32 %s16, %v17
+  %v18 = load i32, i32* @g18
+  %s18 = add i32 %s17, %v18
+  %v19 = load i32, i32* @g19
+  %s19 = add i32 %s18, %v19
+  %v20 = load i32, i32* @g20
+  %s20 = add i32 %s19, %v20
+  %v21 = load i32, i32* @g21
+  %s21 = add i32 %s20, %v21
+  %v22 = load i32, i32* @g22
+  %s22 = add i32 %s21, %v22
+  %v23 = load i32, i32* @g23
+  %s23 = add i32 %s22, %v23
+  %v24 = load i32, i32* @g24
+  %s24 = add i32 %s23, %v24
+  %v25 = load i32, i32* @g25
+  %s25 = add i32 %s24, %v25
+  %v26 = load i32, i32* @g26
+  %s26 = add i32 %s25, %v26
+  %v27 = load i32, i32* @g27
+  %s27 = add i32 %s26, %v27
+  %v28 = load i32, i32* @g28
+  %s28 = add i32 %s27, %v28
+  %v29 = load i32, i32* @g29
+  %s29 = add i32 %s28, %v29
+  %v30 = load i32, i32* @g30
+  %s30 = add i32 %s29, %v30
+  %v31 = load i32, i32* @g31
+  %s31 = add i32 %s30, %v31
+  %ok.sum = icmp eq i32 %s31, 528
+  %b = load i32, i32* %last
+  %ok.big = icmp eq i32 %b, 7
+  %ok = and i1 %ok.sum, %ok.big
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
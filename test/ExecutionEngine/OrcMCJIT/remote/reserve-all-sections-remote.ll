@@ -0,0 +1,38 @@
+; RUN: %lli -jit-kind=orc-mcjit -remote-mcjit -debug-only=orc-remote \
+; RUN:   -mcjit-remote-process=lli-child-target%exeext %s 2>&1 | FileCheck %s
+; REQUIRES: asserts
+; XFAIL: mingw32,win32
+
+; The code, read-only data and read-write data of this module are reserved
+; with three ReserveMem requests that are sent together. Check that every
+; reply is collected and the program still runs correctly afterwards.
+
+; CHECK: Allocator {{[0-9]+}} reserved:
+; CHECK-NEXT: code: 0x{{[0-9a-f]+}}
+; CHECK-NEXT: ro-data: 0x{{[0-9a-f]+}}
+; CHECK-NEXT: rw-data: 0x{{[0-9a-f]+}}
+
+@table = private unnamed_addr constant [4 x i32] [i32 3, i32 5, i32 7, i32 11]
+@sum = global i32 0
+
+define i32 @main() nounwind {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %p = getelementptr [4 x i32], [4 x i32]* @table, i64 0, i64 %i
+  %v = load i32, i32* %p
+  %s = load i32, i32* @sum
+  %s.next = add i32 %s, %v
+  store i32 %s.next, i32* @sum
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, 4
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = load i32, i32* @sum
+  %ok = icmp eq i32 %r, 26
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
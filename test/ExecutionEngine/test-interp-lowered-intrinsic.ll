@@ -0,0 +1,29 @@
+; RUN: %lli -force-interpreter=true %s
+;
+; The interpreter lowers @llvm.ctpop into new instructions the first time it
+; runs the call, in the innermost frame of @rec. The outer frames of @rec then
+; execute those instructions too, so they need slots for them as well.
+
+declare i32 @llvm.ctpop.i32(i32)
+
+define i32 @rec(i32 %n) {
+entry:
+  %z = icmp eq i32 %n, 0
+  br i1 %z, label %tail, label %recurse
+recurse:
+  %m = sub i32 %n, 1
+  %r = call i32 @rec(i32 %m)
+  br label %tail
+tail:
+  %acc = phi i32 [ 0, %entry ], [ %r, %recurse ]
+  %c = call i32 @llvm.ctpop.i32(i32 %n)
+  %t = add i32 %acc, %c
+  ret i32 %t
+}
+
+define i32 @main() {
+  %x = call i32 @rec(i32 3)
+  %ok = icmp eq i32 %x, 4
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,55 @@
+; RUN: opt < %s -inline -sroa -argpromotion -disable-output \
+; RUN:   -debug-only=cgscc-passmgr 2>&1 | FileCheck %s --check-prefix=DEBUG
+; RUN: opt < %s -S -inline -sroa -argpromotion | FileCheck %s
+; REQUIRES: asserts
+
+; @f and @g form one SCC. SROA turns the indirect call in @g into a direct
+; call to @h, but leaves @f alone. Before argpromotion runs, the call graph
+; is refreshed: @g has to be rescanned so that the devirtualized call is
+; noticed and the SCC revisited, which lets the inliner inline @h. @f has
+; not changed and is skipped.
+
+; DEBUG: CGSCCPASSMGR: Pass Dirtied SCC: Function Pass Manager
+; DEBUG-NEXT: CGSCCPASSMGR: Refreshing SCC with 2 nodes:
+; DEBUG-NOT: Skipping unchanged function 'g'
+; DEBUG: CGSCCPASSMGR: Devirtualized call to 'h'
+; DEBUG-NOT: Skipping unchanged function 'g'
+; DEBUG: CGSCCPASSMGR: Skipping unchanged function 'f'
+; DEBUG: CGSCCPASSMGR: Refresh devirtualized a call!
+; DEBUG: SCCPASSMGR: Re-visiting SCC, iteration #1
+
+; CHECK-NOT: define internal i32 @h(
+; CHECK-LABEL: define i32 @f(
+; CHECK: call i32 @g(i32 %m, i32* %p)
+; CHECK-LABEL: define i32 @g(
+; CHECK-NOT: call i32 %
+; CHECK: load i32, i32* %p
+; CHECK-NEXT: call i32 @f(i32 %n, i32* %p)
+
+define internal i32 @h(i32* %p) {
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+define i32 @f(i32 %n, i32* %p) noinline {
+  %c = icmp eq i32 %n, 0
+  br i1 %c, label %done, label %rec
+
+rec:
+  %m = sub i32 %n, 1
+  %r = call i32 @g(i32 %m, i32* %p)
+  ret i32 %r
+
+done:
+  ret i32 0
+}
+
+define i32 @g(i32 %n, i32* %p) noinline {
+  %fp.addr = alloca i32 (i32*)*
+  store i32 (i32*)* @h, i32 (i32*)** %fp.addr
+  %fp = load i32 (i32*)*, i32 (i32*)** %fp.addr
+  %v = call i32 %fp(i32* %p)
+  %r = call i32 @f(i32 %n, i32* %p)
+  %s = add i32 %v, %r
+  ret i32 %s
+}
@@ -0,0 +1,55 @@
+; RUN: opt < %s -loop-vectorize -force-vector-width=4 -force-vector-interleave=1 -vectorizer-report-loop-times -pass-remarks-analysis=loop-vectorize -S 2>&1 | FileCheck %s
+; RUN: opt < %s -loop-vectorize -force-vector-width=4 -force-vector-interleave=1 -pass-remarks-analysis=loop-vectorize -S 2>&1 | FileCheck %s --check-prefix=NOREPORT
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Each loop gets its own report, including loops that are rejected before
+; cost modeling or code generation.
+; CHECK: remark: {{.*}}:0:0: vectorizer time: Legality Analysis {{[0-9.]+}}s, Cost Modeling {{[0-9.]+}}s, Code Generation {{[0-9.]+}}s
+; CHECK: remark: {{.*}}:0:0: vectorizer time: Legality Analysis {{[0-9.]+}}s, Cost Modeling 0.000000s, Code Generation 0.000000s
+; CHECK-LABEL: @vectorized(
+; CHECK: <4 x i32>
+; CHECK-LABEL: @not_vectorized(
+
+; NOREPORT-NOT: vectorizer time
+
+define void @vectorized(i32* noalias %a, i32* noalias %b) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %pb = getelementptr inbounds i32, i32* %b, i64 %i
+  %v = load i32, i32* %pb, align 4
+  %add = add nsw i32 %v, 1
+  %pa = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 %add, i32* %pa, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; The early exit makes the loop control flow unsupported.
+define i32 @not_vectorized(i32* %a, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %pa = getelementptr inbounds i32, i32* %a, i64 %i
+  %v = load i32, i32* %pa, align 4
+  %found = icmp eq i32 %v, %n
+  br i1 %found, label %exit, label %latch
+
+latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ 1, %loop ], [ 0, %latch ]
+  ret i32 %r
+}
@@ -0,0 +1,46 @@
+; RUN: opt < %s -basicaa -slp-vectorizer -S -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7-avx | FileCheck %s
+; RUN: opt < %s -basicaa -slp-vectorizer -disable-output -stats -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7-avx 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The store chain c[0..2] is tried as two trees in the same block. The first
+; one, {c[0], c[1]}, cannot be vectorized and leaves its scheduling region
+; behind. The region already contains the first bundle of the second tree,
+; {c[1], c[2]}, so that tree reuses it and extends it up to the loads. The
+; result must be the same as when every tree builds its own region.
+
+; STATS: 1 SLP {{.*}} Number of scheduling regions reused from a previous tree
+
+; CHECK-LABEL: @two_trees(
+; CHECK: [[A:%.*]] = load <2 x double>
+; CHECK: [[B:%.*]] = load <2 x double>
+; CHECK: %v0 = fdiv double %a0, %b0
+; CHECK: [[M:%.*]] = fmul <2 x double> [[A]], [[B]]
+; CHECK: store double %v0, double* %c, align 8
+; CHECK: [[P:%.*]] = bitcast double* %c1p to <2 x double>*
+; CHECK-NEXT: store <2 x double> [[M]], <2 x double>* [[P]], align 8
+; CHECK-NEXT: ret void
+define void @two_trees(double* noalias %a, double* noalias %b, double* noalias %c) {
+entry:
+  %a0 = load double, double* %a, align 8
+  %a1p = getelementptr inbounds double, double* %a, i64 1
+  %a1 = load double, double* %a1p, align 8
+  %a2p = getelementptr inbounds double, double* %a, i64 2
+  %a2 = load double, double* %a2p, align 8
+  %b0 = load double, double* %b, align 8
+  %b1p = getelementptr inbounds double, double* %b, i64 1
+  %b1 = load double, double* %b1p, align 8
+  %b2p = getelementptr inbounds double, double* %b, i64 2
+  %b2 = load double, double* %b2p, align 8
+  %v0 = fdiv double %a0, %b0
+  %v1 = fmul double %a1, %b1
+  %v2 = fmul double %a2, %b2
+  %c1p = getelementptr inbounds double, double* %c, i64 1
+  %c2p = getelementptr inbounds double, double* %c, i64 2
+  store double %v0, double* %c, align 8
+  store double %v2, double* %c2p, align 8
+  store double %v1, double* %c1p, align 8
+  ret void
+}
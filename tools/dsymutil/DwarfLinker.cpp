@@ -36,8 +36,10 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
+#include <deque>
 #include <string>
 #include <tuple>
 
@@ -1112,8 +1114,7 @@ void DwarfStreamer::emitFDE(uint32_t CIEOffset, uint32_t AddrSize,
 class DwarfLinker {
 public:
   DwarfLinker(StringRef OutputFilename, const LinkOptions &Options)
-      : OutputFilename(OutputFilename), Options(Options),
-        BinHolder(Options.Verbose), LastCIEOffset(0) {}
+      : OutputFilename(OutputFilename), Options(Options), LastCIEOffset(0) {}
 
   /// \brief Link the contents of the DebugMap.
   bool link(const DebugMap &);
@@ -1189,6 +1190,39 @@ private:
                           bool isLittleEndian);
   };
 
+  /// The inputs of the link of one debug map object that do not depend on
+  /// the objects linked before it. They are prepared ahead of the object's
+  /// turn so that parsing its debug info can overlap with the link of the
+  /// previous objects.
+  struct LinkContext {
+    DebugMapObject &DMO;
+    /// Owns the object file, independently of the other in-flight objects.
+    BinaryHolder BinHolder;
+    const object::ObjectFile *ObjectFile;
+    RelocationManager RelocMgr;
+    std::unique_ptr<DWARFContextInMemory> DwarfContext;
+    /// Completion of parseDebugInfo() when it runs on the thread pool.
+    std::shared_future<ThreadPool::VoidTy> Parsed;
+
+    LinkContext(DwarfLinker &Linker, DebugMapObject &DMO, bool Verbose)
+        : DMO(DMO), BinHolder(Verbose), ObjectFile(nullptr),
+          RelocMgr(Linker) {}
+
+    /// Build the DWARF context of the object and extract all its DIEs.
+    void parseDebugInfo() {
+      DwarfContext.reset(new DWARFContextInMemory(*ObjectFile));
+      DwarfContext->extractAllDIEs(1);
+    }
+  };
+
+  /// Load \p Obj and look for its relocations that match debug map entries.
+  /// \returns null if the object has nothing to link.
+  std::unique_ptr<LinkContext> prepareDebugObject(DebugMapObject &Obj,
+                                                  const DebugMap &Map);
+
+  /// Link the debug info of a prepared and parsed object into the output.
+  void linkDebugObject(LinkContext &Ctx, DebugMap &ModuleMap);
+
   /// \defgroup FindRootDIEs Find DIEs corresponding to debug map entries.
   ///
   /// @{
@@ -1424,7 +1458,6 @@ private:
 
   std::string OutputFilename;
   LinkOptions Options;
-  BinaryHolder BinHolder;
   std::unique_ptr<DwarfStreamer> Streamer;
   uint64_t OutputDebugInfoSize;
   unsigned UnitID; ///< A unique ID that identifies each compile unit.
@@ -3351,6 +3384,74 @@ void DwarfLinker::DIECloner::cloneAllCompileUnits(
   }
 }
 
+std::unique_ptr<DwarfLinker::LinkContext>
+DwarfLinker::prepareDebugObject(DebugMapObject &Obj, const DebugMap &Map) {
+  CurrentDebugObject = &Obj;
+
+  if (Options.Verbose)
+    outs() << "DEBUG MAP OBJECT: " << Obj.getObjectFilename() << "\n";
+  auto Ctx = llvm::make_unique<LinkContext>(*this, Obj, Options.Verbose);
+  auto ErrOrObj = loadObject(Ctx->BinHolder, Obj, Map);
+  if (!ErrOrObj)
+    return nullptr;
+
+  // Look for relocations that correspond to debug map entries.
+  if (!Ctx->RelocMgr.findValidRelocsInDebugInfo(*ErrOrObj, Obj)) {
+    if (Options.Verbose)
+      outs() << "No valid relocations found. Skipping.\n";
+    return nullptr;
+  }
+  Ctx->ObjectFile = &*ErrOrObj;
+  return Ctx;
+}
+
+void DwarfLinker::linkDebugObject(LinkContext &Ctx, DebugMap &ModuleMap) {
+  CurrentDebugObject = &Ctx.DMO;
+  DWARFContextInMemory &DwarfContext = *Ctx.DwarfContext;
+  RelocationManager &RelocMgr = Ctx.RelocMgr;
+  startDebugObject(DwarfContext, Ctx.DMO);
+
+  // In a first phase, just read in the debug info and load all clang modules.
+  for (const auto &CU : DwarfContext.compile_units()) {
+    auto *CUDie = CU->getUnitDIE(false);
+    if (Options.Verbose) {
+      outs() << "Input compilation unit:";
+      CUDie->dump(outs(), CU.get(), 0);
+    }
+
+    if (!registerModuleReference(*CUDie, *CU, ModuleMap))
+      Units.emplace_back(*CU, UnitID++, !Options.NoODR, "");
+  }
+
+  // Now build the DIE parent links that we will use during the next phase.
+  for (auto &CurrentUnit : Units)
+    analyzeContextInfo(CurrentUnit.getOrigUnit().getUnitDIE(), 0, CurrentUnit,
+                       &ODRContexts.getRoot(), StringPool, ODRContexts);
+
+  // Then mark all the DIEs that need to be present in the linked
+  // output and collect some information about them. Note that this
+  // loop can not be merged with the previous one becaue cross-cu
+  // references require the ParentIdx to be setup for every CU in
+  // the object file before calling this.
+  for (auto &CurrentUnit : Units)
+    lookForDIEsToKeep(RelocMgr, *CurrentUnit.getOrigUnit().getUnitDIE(),
+                      Ctx.DMO, CurrentUnit, 0);
+
+  // The calls to applyValidRelocs inside cloneDIE will walk the
+  // reloc array again (in the same way findValidRelocsInDebugInfo()
+  // did). We need to reset the NextValidReloc index to the beginning.
+  RelocMgr.resetValidRelocs();
+  if (RelocMgr.hasValidRelocs())
+    DIECloner(*this, RelocMgr, DIEAlloc, Units, Options)
+        .cloneAllCompileUnits(DwarfContext);
+  if (!Options.NoOutput && !Units.empty())
+    patchFrameInfoForObject(Ctx.DMO, DwarfContext,
+                            Units[0].getOrigUnit().getAddressByteSize());
+
+  // Clean-up before starting working on the next object.
+  endDebugObject();
+}
+
 bool DwarfLinker::link(const DebugMap &Map) {
 
   if (!createStreamer(Map.getTriple(), OutputFilename))
@@ -3362,66 +3463,45 @@ bool DwarfLinker::link(const DebugMap &Map) {
   UnitID = 0;
   DebugMap ModuleMap(Map.getTriple(), Map.getBinaryPath());
 
-  for (const auto &Obj : Map.objects()) {
-    CurrentDebugObject = Obj.get();
-
-    if (Options.Verbose)
-      outs() << "DEBUG MAP OBJECT: " << Obj->getObjectFilename() << "\n";
-    auto ErrOrObj = loadObject(BinHolder, *Obj, Map);
-    if (!ErrOrObj)
-      continue;
-
-    // Look for relocations that correspond to debug map entries.
-    RelocationManager RelocMgr(*this);
-    if (!RelocMgr.findValidRelocsInDebugInfo(*ErrOrObj, *Obj)) {
-      if (Options.Verbose)
-        outs() << "No valid relocations found. Skipping.\n";
-      continue;
-    }
-
-    // Setup access to the debug info.
-    DWARFContextInMemory DwarfContext(*ErrOrObj);
-    startDebugObject(DwarfContext, *Obj);
-
-    // In a first phase, just read in the debug info and load all clang modules.
-    for (const auto &CU : DwarfContext.compile_units()) {
-      auto *CUDie = CU->getUnitDIE(false);
-      if (Options.Verbose) {
-        outs() << "Input compilation unit:";
-        CUDie->dump(outs(), CU.get(), 0);
+  std::vector<DebugMapObject *> Objects;
+  for (const auto &Obj : Map.objects())
+    Objects.push_back(Obj.get());
+
+  // The link of an object depends on all the objects linked before it (ODR
+  // uniquing, output offsets, the string pool), so it happens in debug map
+  // order on this thread. Loading an object and finding its relocations are
+  // cheap and can warn, so they also happen in order, but up to NumThreads
+  // objects ahead. The expensive part of the preparation, parsing the debug
+  // info, then runs on the pool while the previous objects are linked.
+  // Verbose output is interleaved with the link, so it disables this.
+  unsigned NumThreads = Options.Verbose ? 1 : Options.NumThreads;
+  std::unique_ptr<ThreadPool> Pool;
+  if (NumThreads > 1)
+    Pool.reset(new ThreadPool(NumThreads - 1));
+  size_t Lookahead = NumThreads > 1 ? NumThreads : 0;
+
+  std::deque<std::unique_ptr<LinkContext>> Prepared;
+  size_t NextToPrepare = 0;
+  for (size_t I = 0, E = Objects.size(); I != E; ++I) {
+    for (; NextToPrepare != E && NextToPrepare <= I + Lookahead;
+         ++NextToPrepare) {
+      auto Ctx = prepareDebugObject(*Objects[NextToPrepare], Map);
+      if (Ctx && Pool) {
+        LinkContext *C = Ctx.get();
+        Ctx->Parsed = Pool->async([C] { C->parseDebugInfo(); });
       }
-
-      if (!registerModuleReference(*CUDie, *CU, ModuleMap))
-        Units.emplace_back(*CU, UnitID++, !Options.NoODR, "");
+      Prepared.push_back(std::move(Ctx));
     }
 
-    // Now build the DIE parent links that we will use during the next phase.
-    for (auto &CurrentUnit : Units)
-      analyzeContextInfo(CurrentUnit.getOrigUnit().getUnitDIE(), 0, CurrentUnit,
-                         &ODRContexts.getRoot(), StringPool, ODRContexts);
-
-    // Then mark all the DIEs that need to be present in the linked
-    // output and collect some information about them. Note that this
-    // loop can not be merged with the previous one becaue cross-cu
-    // references require the ParentIdx to be setup for every CU in
-    // the object file before calling this.
-    for (auto &CurrentUnit : Units)
-      lookForDIEsToKeep(RelocMgr, *CurrentUnit.getOrigUnit().getUnitDIE(), *Obj,
-                        CurrentUnit, 0);
-
-    // The calls to applyValidRelocs inside cloneDIE will walk the
-    // reloc array again (in the same way findValidRelocsInDebugInfo()
-    // did). We need to reset the NextValidReloc index to the beginning.
-    RelocMgr.resetValidRelocs();
-    if (RelocMgr.hasValidRelocs())
-      DIECloner(*this, RelocMgr, DIEAlloc, Units, Options)
-          .cloneAllCompileUnits(DwarfContext);
-    if (!Options.NoOutput && !Units.empty())
-      patchFrameInfoForObject(*Obj, DwarfContext,
-                              Units[0].getOrigUnit().getAddressByteSize());
-
-    // Clean-up before starting working on the next object.
-    endDebugObject();
+    std::unique_ptr<LinkContext> Ctx = std::move(Prepared.front());
+    Prepared.pop_front();
+    if (!Ctx)
+      continue;
+    if (Ctx->Parsed.valid())
+      Ctx->Parsed.wait();
+    else
+      Ctx->parseDebugInfo();
+    linkDebugObject(*Ctx, ModuleMap);
   }
 
   // Emit everything that's global.
@@ -24,8 +24,10 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
+#include <algorithm>
 #include <cstdint>
 #include <string>
+#include <thread>
 
 using namespace llvm::dsymutil;
 
@@ -82,6 +84,14 @@ static opt<bool>
           desc("Do not use ODR (One Definition Rule) for type uniquing."),
           init(false), cat(DsymCategory));
 
+static opt<unsigned> NumThreads(
+    "num-threads",
+    desc("Specifies the maximum number (n) of simultaneous threads to use\n"
+         "when linking multiple object files (default: autodetect)."),
+    init(0), cat(DsymCategory));
+static alias NumThreadsA("j", desc("Alias for --num-threads"),
+                         aliasopt(NumThreads));
+
 static opt<bool> DumpDebugMap(
     "dump-debug-map",
     desc("Parse and dump the debug map to standard output. Not DWARF link "
@@ -261,6 +271,9 @@ int main(int argc, char **argv) {
   Options.Verbose = Verbose;
   Options.NoOutput = NoOutput;
   Options.NoODR = NoODR;
+  Options.NumThreads = NumThreads;
+  if (Options.NumThreads == 0)
+    Options.NumThreads = std::max(1U, std::thread::hardware_concurrency());
   Options.PrependPath = OsoPrependPath;
 
   llvm::InitializeAllTargetInfos();
@@ -8,14 +8,31 @@
 //===----------------------------------------------------------------------===//
 
 #include "OrcLazyJIT.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ExecutionEngine/Orc/DirectoryObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/OrcArchitectureSupport.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include <cstdio>
 #include <system_error>
 
 using namespace llvm;
 
+#define DEBUG_TYPE "orc-lazy-jit"
+
+STATISTIC(NumHotPartitions, "Number of hot partitions recompiled");
+STATISTIC(NumHotFunctions, "Number of stubs repointed at hot functions");
+
+// The symbols through which instrumented code calls back into the JIT in
+// tiered mode. The resolver maps them to hotPartitionCallback and the JIT
+// instance, so that the IR does not depend on where either lives.
+static const char *const HotCallbackName = "__orc_lazyjit_hot";
+static const char *const HotInstanceName = "__orc_lazyjit_instance";
+
 namespace {
 
   enum class DumpKind { NoDump, DumpFuncsToStdOut, DumpModsToStdErr,
@@ -44,6 +61,30 @@ namespace {
   cl::opt<bool> OrcInlineStubs("orc-lazy-inline-stubs",
                                cl::desc("Try to inline stubs"),
                                cl::init(true), cl::Hidden);
+
+  cl::opt<bool> OrcSpeculateCallees("orc-lazy-speculate-callees",
+                                    cl::desc("Compile the functions a lazily "
+                                             "compiled function calls "
+                                             "directly along with it"),
+                                    cl::init(false), cl::Hidden);
+
+  cl::opt<bool> OrcTiered("orc-lazy-tiered",
+                          cl::desc("Compile functions at -O0 first, then "
+                                   "recompile hot functions at the requested "
+                                   "optimization level"),
+                          cl::init(false), cl::Hidden);
+
+  cl::opt<unsigned> OrcHotCallThreshold("orc-lazy-hot-threshold",
+                                        cl::desc("Number of calls after which "
+                                                 "a function is considered "
+                                                 "hot in tiered mode"),
+                                        cl::init(1000), cl::Hidden);
+
+  cl::opt<std::string> OrcObjectCacheDir("orc-lazy-object-cache-dir",
+                                         cl::desc("Directory in which to "
+                                                  "cache compiled partitions "
+                                                  "across runs"),
+                                         cl::init(""), cl::Hidden);
 }
 
 std::unique_ptr<OrcLazyJIT::CompileCallbackMgr>
@@ -121,6 +162,138 @@ OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper() {
   llvm_unreachable("Unknown DumpKind");
 }
 
+OrcLazyJIT::TransformFtor OrcLazyJIT::createIRTransform() {
+  auto DebugDumper = createDebugDumper();
+  return [this, DebugDumper](std::unique_ptr<Module> M) {
+    if (HotCompileLayer)
+      M = addHotnessCounters(std::move(M));
+    return DebugDumper(std::move(M));
+  };
+}
+
+std::unique_ptr<Module>
+OrcLazyJIT::addHotnessCounters(std::unique_ptr<Module> M) {
+  // Only count calls to real definitions. Available-externally functions are
+  // inlinable copies of the stubs, and the globals module defines none.
+  std::vector<Function*> Fns;
+  for (auto &F : *M)
+    if (!F.isDeclaration() && !F.hasAvailableExternallyLinkage())
+      Fns.push_back(&F);
+  if (Fns.empty())
+    return M;
+
+  uint64_t PartitionID = PendingHotPartitions.size();
+  PendingHotPartitions.push_back(CloneModule(M.get()));
+
+  LLVMContext &Ctx = M->getContext();
+  IRBuilder<> B(Ctx);
+  Type *CounterTy = B.getInt32Ty();
+  Type *CallbackArgTys[] = { B.getInt8PtrTy(), B.getInt64Ty() };
+  FunctionType *CallbackTy =
+    FunctionType::get(B.getVoidTy(), CallbackArgTys, false);
+  Constant *Callback = M->getOrInsertFunction(HotCallbackName, CallbackTy);
+  Constant *JITPtr = M->getOrInsertGlobal(HotInstanceName, B.getInt8Ty());
+
+  for (auto *F : Fns) {
+    auto *Counter =
+      new GlobalVariable(*M, CounterTy, false, GlobalValue::InternalLinkage,
+                         Constant::getNullValue(CounterTy),
+                         F->getName() + "$call_count");
+
+    // Count the call after the entry block's allocas so that they stay
+    // static allocas.
+    BasicBlock &Entry = F->getEntryBlock();
+    BasicBlock::iterator InsertPt = Entry.begin();
+    while (isa<AllocaInst>(InsertPt))
+      ++InsertPt;
+    B.SetInsertPoint(&Entry, InsertPt);
+    Value *Count = B.CreateAdd(B.CreateLoad(Counter), B.getInt32(1));
+    B.CreateStore(Count, Counter);
+    Value *IsHot = B.CreateICmpEQ(Count, B.getInt32(HotCallThreshold));
+    B.SetInsertPoint(SplitBlockAndInsertIfThen(IsHot, &*InsertPt, false));
+    B.CreateCall(Callback, { JITPtr, B.getInt64(PartitionID) });
+  }
+
+  return M;
+}
+
+void OrcLazyJIT::hotPartitionCallback(OrcLazyJIT *J, uint64_t PartitionID) {
+  J->recompileHotPartition(PartitionID);
+}
+
+RuntimeDyld::SymbolInfo OrcLazyJIT::findHotnessSymbol(const std::string &Name) {
+  if (!HotCompileLayer)
+    return nullptr;
+  if (Name == mangle(HotCallbackName))
+    return RuntimeDyld::SymbolInfo(
+        static_cast<uint64_t>(
+            reinterpret_cast<uintptr_t>(&hotPartitionCallback)),
+        JITSymbolFlags::Exported);
+  if (Name == mangle(HotInstanceName))
+    return RuntimeDyld::SymbolInfo(
+        static_cast<uint64_t>(reinterpret_cast<uintptr_t>(this)),
+        JITSymbolFlags::Exported);
+  return nullptr;
+}
+
+void OrcLazyJIT::recompileHotPartition(uint64_t PartitionID) {
+  // Every function in a partition shares the partition's ID, so only the
+  // first of them to become hot triggers the recompile.
+  std::unique_ptr<Module> M = std::move(PendingHotPartitions[PartitionID]);
+  if (!M)
+    return;
+
+  std::vector<std::string> FnNames;
+  for (auto &F : *M)
+    if (!F.isDeclaration() && !F.hasAvailableExternallyLinkage())
+      FnNames.push_back(mangle(F.getName()));
+
+  // References out of the partition resolve exactly as they did for the -O0
+  // copy: stubs (and stub pointers) first, then globals, then the process.
+  std::shared_ptr<RuntimeDyld::SymbolResolver> Resolver =
+    orc::createLambdaResolver(
+      [this](const std::string &Name) {
+        if (auto Sym = CODLayer.findSymbol(Name, false))
+          return RuntimeDyld::SymbolInfo(Sym.getAddress(), Sym.getFlags());
+        if (auto Sym = findHotnessSymbol(Name))
+          return Sym;
+        if (auto Sym = CXXRuntimeOverrides.searchOverrides(Name))
+          return Sym;
+        if (auto Addr = RTDyldMemoryManager::getSymbolAddressInProcess(Name))
+          return RuntimeDyld::SymbolInfo(Addr, JITSymbolFlags::Exported);
+        return RuntimeDyld::SymbolInfo(nullptr);
+      },
+      [](const std::string &Name) {
+        return RuntimeDyld::SymbolInfo(nullptr);
+      });
+
+  std::vector<std::unique_ptr<Module>> S;
+  S.push_back(std::move(M));
+  auto H = HotCompileLayer->addModuleSet(std::move(S), &HotMemMgr,
+                                         std::move(Resolver));
+  ++NumHotPartitions;
+  DEBUG(dbgs() << "Recompiled hot partition " << PartitionID << "\n");
+
+  // The -O0 bodies stay in place: other frames may still be executing them.
+  // If a function cannot be repointed it keeps running its -O0 body, which
+  // is correct but slow, so say so.
+  for (auto &Name : FnNames) {
+    auto Sym = HotCompileLayer->findSymbolIn(H, Name, false);
+    if (!Sym) {
+      errs() << "warning: hot recompile of '" << Name
+             << "' produced no definition; keeping the unoptimized body\n";
+      continue;
+    }
+    if (!CODLayer.updatePointer(Name, Sym.getAddress())) {
+      errs() << "warning: cannot repoint the stub of '" << Name
+             << "' at its hot body; keeping the unoptimized body\n";
+      continue;
+    }
+    ++NumHotFunctions;
+    DEBUG(dbgs() << "Repointed " << Name << " at its hot body\n");
+  }
+}
+
 // Defined in lli.cpp.
 CodeGenOpt::Level getOptLevel();
 
@@ -142,6 +315,16 @@ int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
   EngineBuilder EB;
   EB.setOptLevel(getOptLevel());
   auto TM = std::unique_ptr<TargetMachine>(EB.selectTarget());
+
+  // In tiered mode the requested optimization level is used for hot
+  // functions only. Everything else is compiled at -O0, which selects
+  // FastISel and the fast register allocator.
+  std::unique_ptr<TargetMachine> HotTM;
+  if (OrcTiered) {
+    HotTM = std::move(TM);
+    EB.setOptLevel(CodeGenOpt::None);
+    TM = std::unique_ptr<TargetMachine>(EB.selectTarget());
+  }
   auto CompileCallbackMgr =
     OrcLazyJIT::createCompileCallbackMgr(Triple(TM->getTargetTriple()));
 
@@ -163,10 +346,25 @@ int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
     return 1;
   }
 
+  // Objects are only valid for the settings they were compiled with, so
+  // make those part of the cache key.
+  std::unique_ptr<orc::DirectoryObjectCache> ObjCache;
+  if (!OrcObjectCacheDir.empty())
+    ObjCache = llvm::make_unique<orc::DirectoryObjectCache>(
+        OrcObjectCacheDir,
+        (TM->getTargetCPU() + "|" + TM->getTargetFeatureString() + "|" +
+         utostr(TM->getOptLevel())).str());
+
   // Everything looks good. Build the JIT.
+  OrcLazyJIT::CODLayerT::PartitioningFtor Partition =
+    OrcSpeculateCallees ? OrcLazyJIT::CODLayerT::compileWithDirectCallees
+                        : OrcLazyJIT::CODLayerT::compileRequested;
   OrcLazyJIT J(std::move(TM), std::move(CompileCallbackMgr),
                std::move(IndirectStubsMgrBuilder),
-               OrcInlineStubs);
+               OrcInlineStubs, std::move(Partition), std::move(HotTM),
+               OrcHotCallThreshold);
+  if (ObjCache)
+    J.setObjectCache(ObjCache.get());
 
   // Add the module, look up main and run it.
   auto MainHandle = J.addModule(std::move(M));
@@ -40,19 +40,33 @@ public:
     IndirectStubsManagerBuilder;
   typedef CODLayerT::ModuleSetHandleT ModuleHandleT;
 
+  /// Construct a lazy JIT. Partition picks the functions compiled together
+  /// when a stub is first called. If HotTM is non-null the JIT runs in tiered
+  /// mode: functions are first compiled with TM (which should be set up for
+  /// -O0), and any function called HotCallThreshold times is recompiled
+  /// with HotTM and its stub repointed at the new body.
   OrcLazyJIT(std::unique_ptr<TargetMachine> TM,
              std::unique_ptr<CompileCallbackMgr> CCMgr,
              IndirectStubsManagerBuilder IndirectStubsMgrBuilder,
-             bool InlineStubs)
+             bool InlineStubs,
+             CODLayerT::PartitioningFtor Partition =
+               CODLayerT::compileRequested,
+             std::unique_ptr<TargetMachine> HotTM = nullptr,
+             unsigned HotCallThreshold = 0)
       : TM(std::move(TM)), DL(this->TM->createDataLayout()),
 	CCMgr(std::move(CCMgr)),
 	ObjectLayer(),
         CompileLayer(ObjectLayer, orc::SimpleCompiler(*this->TM)),
-        IRDumpLayer(CompileLayer, createDebugDumper()),
-        CODLayer(IRDumpLayer, extractSingleFunction, *this->CCMgr,
+        IRDumpLayer(CompileLayer, createIRTransform()),
+        CODLayer(IRDumpLayer, std::move(Partition), *this->CCMgr,
                  std::move(IndirectStubsMgrBuilder), InlineStubs),
         CXXRuntimeOverrides(
-            [this](const std::string &S) { return mangle(S); }) {}
+            [this](const std::string &S) { return mangle(S); }),
+        HotTM(std::move(HotTM)), HotCallThreshold(HotCallThreshold) {
+    if (this->HotTM)
+      HotCompileLayer = llvm::make_unique<CompileLayerT>(
+          ObjectLayer, orc::SimpleCompiler(*this->HotTM));
+  }
 
   ~OrcLazyJIT() {
     // Run any destructors registered with __cxa_atexit.
@@ -62,6 +76,9 @@ public:
       DtorRunner.runViaLayer(CODLayer);
   }
 
+  /// Query Cache for previously compiled objects before compiling partitions.
+  void setObjectCache(ObjectCache *Cache) { CompileLayer.setObjectCache(Cache); }
+
   static std::unique_ptr<CompileCallbackMgr> createCompileCallbackMgr(Triple T);
   static IndirectStubsManagerBuilder createIndirectStubsMgrBuilder(Triple T);
 
@@ -80,14 +97,17 @@ public:
 
     // Symbol resolution order:
     //   1) Search the JIT symbols.
-    //   2) Check for C++ runtime overrides.
-    //   3) Search the host process (LLI)'s symbol table.
+    //   2) Check for the tiered mode callback symbols.
+    //   3) Check for C++ runtime overrides.
+    //   4) Search the host process (LLI)'s symbol table.
     std::shared_ptr<RuntimeDyld::SymbolResolver> Resolver =
       orc::createLambdaResolver(
         [this](const std::string &Name) {
           if (auto Sym = CODLayer.findSymbol(Name, true))
             return RuntimeDyld::SymbolInfo(Sym.getAddress(),
                                            Sym.getFlags());
+          if (auto Sym = findHotnessSymbol(Name))
+            return Sym;
           if (auto Sym = CXXRuntimeOverrides.searchOverrides(Name))
             return Sym;
 
@@ -138,14 +158,26 @@ private:
     return MangledName;
   }
 
-  static std::set<Function*> extractSingleFunction(Function &F) {
-    std::set<Function*> Partition;
-    Partition.insert(&F);
-    return Partition;
-  }
-
   static TransformFtor createDebugDumper();
 
+  TransformFtor createIRTransform();
+
+  /// Tiered mode: stash an uninstrumented copy of the partition M for later
+  /// recompilation, then add a call counter to each function in M that calls
+  /// back into the JIT once the function becomes hot. The callback and this
+  /// JIT are referenced by name, so the instrumented IR is the same on every
+  /// run and objects compiled from it can be cached.
+  std::unique_ptr<Module> addHotnessCounters(std::unique_ptr<Module> M);
+
+  /// Tiered mode: recompile the stashed partition PartitionID with HotTM and
+  /// repoint the stubs of its functions at the recompiled bodies.
+  void recompileHotPartition(uint64_t PartitionID);
+
+  static void hotPartitionCallback(OrcLazyJIT *J, uint64_t PartitionID);
+
+  /// Tiered mode: resolve the callback symbols referenced by the counters.
+  RuntimeDyld::SymbolInfo findHotnessSymbol(const std::string &Name);
+
   std::unique_ptr<TargetMachine> TM;
   DataLayout DL;
   SectionMemoryManager CCMgrMemMgr;
@@ -158,6 +190,13 @@ private:
 
   orc::LocalCXXRuntimeOverrides CXXRuntimeOverrides;
   std::vector<orc::CtorDtorRunner<CODLayerT>> IRStaticDestructorRunners;
+
+  // Tiered compilation state. HotCompileLayer is only created in tiered mode.
+  std::unique_ptr<TargetMachine> HotTM;
+  unsigned HotCallThreshold;
+  std::unique_ptr<CompileLayerT> HotCompileLayer;
+  SectionMemoryManager HotMemMgr;
+  std::vector<std::unique_ptr<Module>> PendingHotPartitions;
 };
 
 int runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]);
@@ -17,6 +17,11 @@
 #include "llvm/ExecutionEngine/Orc/RPCChannel.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
 #else
@@ -24,30 +29,106 @@
 #endif
 
 /// RPC channel that reads from and writes from file descriptors.
+///
+/// Both directions are buffered so that an RPC call and its arguments (or a
+/// response and its payload) travel in one write and are picked up by one
+/// read, rather than costing a system call per serialized field. Output is
+/// flushed by send().
 class FDRPCChannel final : public llvm::orc::remote::RPCChannel {
 public:
-  FDRPCChannel(int InFD, int OutFD) : InFD(InFD), OutFD(OutFD) {}
+  FDRPCChannel(int InFD, int OutFD)
+      : InFD(InFD), OutFD(OutFD), InBuffer(BufferSize), InBegin(0),
+        InEnd(0) {}
 
   std::error_code readBytes(char *Dst, unsigned Size) override {
     assert(Dst && "Attempt to read into null.");
-    ssize_t ReadResult = ::read(InFD, Dst, Size);
-    if (ReadResult != (ssize_t)Size)
-      return std::error_code(errno, std::generic_category());
+    while (Size) {
+      if (InBegin == InEnd) {
+        // Read large payloads straight into their destination.
+        if (Size >= BufferSize)
+          return readFully(Dst, Size);
+        ssize_t ReadResult = readSome(InBuffer.data(), BufferSize);
+        if (ReadResult <= 0)
+          return makeError(ReadResult);
+        InBegin = 0;
+        InEnd = ReadResult;
+      }
+      unsigned Chunk = std::min<unsigned>(Size, InEnd - InBegin);
+      memcpy(Dst, InBuffer.data() + InBegin, Chunk);
+      InBegin += Chunk;
+      Dst += Chunk;
+      Size -= Chunk;
+    }
     return std::error_code();
   }
 
   std::error_code appendBytes(const char *Src, unsigned Size) override {
     assert(Src && "Attempt to append from null.");
-    ssize_t WriteResult = ::write(OutFD, Src, Size);
-    if (WriteResult != (ssize_t)Size)
-      std::error_code(errno, std::generic_category());
+    if (OutBuffer.size() + Size > BufferSize) {
+      if (auto EC = send())
+        return EC;
+      // Write large payloads straight from their source.
+      if (Size >= BufferSize)
+        return writeFully(Src, Size);
+    }
+    OutBuffer.insert(OutBuffer.end(), Src, Src + Size);
     return std::error_code();
   }
 
-  std::error_code send() override { return std::error_code(); }
+  std::error_code send() override {
+    if (OutBuffer.empty())
+      return std::error_code();
+    std::error_code EC = writeFully(OutBuffer.data(), OutBuffer.size());
+    OutBuffer.clear();
+    return EC;
+  }
 
 private:
+  static const unsigned BufferSize = 64 * 1024;
+
+  ssize_t readSome(char *Dst, unsigned Size) {
+    ssize_t ReadResult;
+    do
+      ReadResult = ::read(InFD, Dst, Size);
+    while (ReadResult < 0 && errno == EINTR);
+    return ReadResult;
+  }
+
+  std::error_code readFully(char *Dst, unsigned Size) {
+    while (Size) {
+      ssize_t ReadResult = readSome(Dst, Size);
+      if (ReadResult <= 0)
+        return makeError(ReadResult);
+      Dst += ReadResult;
+      Size -= ReadResult;
+    }
+    return std::error_code();
+  }
+
+  std::error_code writeFully(const char *Src, unsigned Size) {
+    while (Size) {
+      ssize_t WriteResult = ::write(OutFD, Src, Size);
+      if (WriteResult < 0 && errno == EINTR)
+        continue;
+      if (WriteResult <= 0)
+        return makeError(WriteResult);
+      Src += WriteResult;
+      Size -= WriteResult;
+    }
+    return std::error_code();
+  }
+
+  // A zero-byte read or write means the other end has gone away.
+  static std::error_code makeError(ssize_t Result) {
+    if (Result < 0)
+      return std::error_code(errno, std::generic_category());
+    return std::make_error_code(std::errc::broken_pipe);
+  }
+
   int InFD, OutFD;
+  std::vector<char> InBuffer;
+  unsigned InBegin, InEnd;
+  std::vector<char> OutBuffer;
 };
 
 // launch the remote process (see lli.cpp) and return a channel to it.
@@ -173,6 +173,12 @@ namespace {
                            "(must be user writable)"),
                   cl::init(""));
 
+  cl::opt<bool>
+  PerfJITEvents("perf-jit-events",
+        cl::desc("Describe JIT'd code to Linux perf in /tmp/perf-<pid>.map "
+                 "and a jitdump file (only if built with LLVM_USE_PERF)"),
+        cl::init(false));
+
   cl::opt<std::string>
   FakeArgv0("fake-argv0",
             cl::desc("Override the 'argv[0]' value passed into the executing"
@@ -545,6 +551,11 @@ int main(int argc, char **argv, char * const *envp) {
                 JITEventListener::createOProfileJITEventListener());
   EE->RegisterJITEventListener(
                 JITEventListener::createIntelJITEventListener());
+  // The perf listener copies the emitted code out of this process, so it can
+  // only describe code that runs here.
+  if (PerfJITEvents && !RemoteMCJIT)
+    EE->RegisterJITEventListener(
+                JITEventListener::createPerfJITEventListener());
 
   if (!NoLazyCompilation && RemoteMCJIT) {
     errs() << "warning: remote mcjit does not support lazy compilation\n";
@@ -31,8 +31,11 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include <functional>
+#include <mutex>
 #include <system_error>
+#include <thread>
 
 using namespace llvm;
 using namespace coverage;
@@ -67,6 +70,10 @@ public:
   std::unique_ptr<SourceCoverageView>
   createSourceFileView(StringRef SourceFile, CoverageMapping &Coverage);
 
+  /// \brief Render the main source view of a source file to \p OS.
+  void renderSourceFile(StringRef SourceFile, CoverageMapping &Coverage,
+                        bool ShowFilenames, raw_ostream &OS);
+
   /// \brief Load the coverage mapping data. Return true if an error occured.
   std::unique_ptr<CoverageMapping> load();
 
@@ -87,9 +94,12 @@ public:
   std::vector<std::string> SourceFiles;
   std::vector<std::pair<std::string, std::unique_ptr<MemoryBuffer>>>
       LoadedSourceFiles;
+  /// Guards LoadedSourceFiles while files are rendered in parallel.
+  std::mutex LoadedSourceFilesLock;
   bool CompareFilenamesOnly;
   StringMap<std::string> RemappedFilenames;
   std::string CoverageArch;
+  unsigned NumThreads;
 };
 }
 
@@ -108,6 +118,7 @@ CodeCoverageTool::getSourceFile(StringRef SourceFile) {
     if (Loc != RemappedFilenames.end())
       SourceFile = Loc->second;
   }
+  std::lock_guard<std::mutex> Guard(LoadedSourceFilesLock);
   for (const auto &Files : LoadedSourceFiles)
     if (sys::fs::equivalent(SourceFile, Files.first))
       return *Files.second;
@@ -194,6 +205,26 @@ CodeCoverageTool::createSourceFileView(StringRef SourceFile,
   return View;
 }
 
+void CodeCoverageTool::renderSourceFile(StringRef SourceFile,
+                                        CoverageMapping &Coverage,
+                                        bool ShowFilenames, raw_ostream &OS) {
+  auto mainView = createSourceFileView(SourceFile, Coverage);
+  if (!mainView) {
+    ViewOpts.colored_ostream(OS, raw_ostream::RED)
+        << "warning: The file '" << SourceFile << "' isn't covered.";
+    OS << "\n";
+    return;
+  }
+
+  if (ShowFilenames) {
+    ViewOpts.colored_ostream(OS, raw_ostream::CYAN) << SourceFile << ":";
+    OS << "\n";
+  }
+  mainView->render(OS, /*Wholefile=*/true);
+  if (SourceFiles.size() > 1)
+    OS << "\n";
+}
+
 static bool modifiedTimeGT(StringRef LHS, StringRef RHS) {
   sys::fs::file_status Status;
   if (sys::fs::status(LHS, Status))
@@ -209,7 +240,7 @@ std::unique_ptr<CoverageMapping> CodeCoverageTool::load() {
   if (modifiedTimeGT(ObjectFilename, PGOFilename))
     errs() << "warning: profile data may be out of date - object is newer\n";
   auto CoverageOrErr = CoverageMapping::load(ObjectFilename, PGOFilename,
-                                             CoverageArch);
+                                             CoverageArch, NumThreads);
   if (std::error_code EC = CoverageOrErr.getError()) {
     colored_ostream(errs(), raw_ostream::RED)
         << "error: Failed to load coverage: " << EC.message();
@@ -310,6 +341,13 @@ int CodeCoverageTool::run(Command Cmd, int argc, const char **argv) {
       "use-color", cl::desc("Emit colored output (default=autodetect)"),
       cl::init(cl::BOU_UNSET));
 
+  cl::opt<unsigned> NumThreads(
+      "num-threads", cl::init(0),
+      cl::desc("Number of threads to use for loading coverage data and "
+               "rendering source files (default: autodetect)"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads));
+
   auto commandLineParser = [&, this](int argc, const char **argv) -> int {
     cl::ParseCommandLineOptions(argc, argv, "LLVM code coverage tool\n");
     ViewOpts.Debug = DebugDump;
@@ -319,6 +357,10 @@ int CodeCoverageTool::run(Command Cmd, int argc, const char **argv) {
                           ? sys::Process::StandardOutHasColors()
                           : UseColor == cl::BOU_TRUE;
 
+    this->NumThreads = NumThreads;
+    if (this->NumThreads == 0)
+      this->NumThreads = std::max(1U, std::thread::hardware_concurrency());
+
     // Create the function filters
     if (!NameFilters.empty() || !NameRegexFilters.empty()) {
       auto NameFilterer = new CoverageFilters;
@@ -452,24 +494,29 @@ int CodeCoverageTool::show(int argc, const char **argv,
     for (StringRef Filename : Coverage->getUniqueSourceFiles())
       SourceFiles.push_back(Filename);
 
-  for (const auto &SourceFile : SourceFiles) {
-    auto mainView = createSourceFileView(SourceFile, *Coverage);
-    if (!mainView) {
-      ViewOpts.colored_ostream(outs(), raw_ostream::RED)
-          << "warning: The file '" << SourceFile << "' isn't covered.";
-      outs() << "\n";
-      continue;
-    }
-
-    if (ShowFilenames) {
-      ViewOpts.colored_ostream(outs(), raw_ostream::CYAN) << SourceFile << ":";
-      outs() << "\n";
-    }
-    mainView->render(outs(), /*Wholefile=*/true);
-    if (SourceFiles.size() > 1)
-      outs() << "\n";
+  // Colors are emitted by the output stream itself and would be lost when
+  // rendering into a buffer, so colored output is always rendered in order
+  // on this thread.
+  if (NumThreads == 1 || SourceFiles.size() == 1 || ViewOpts.Colors) {
+    for (const auto &SourceFile : SourceFiles)
+      renderSourceFile(SourceFile, *Coverage, ShowFilenames, outs());
+    return 0;
   }
 
+  // Render each file into its own buffer on the thread pool, then print the
+  // buffers in the order the files were given.
+  std::vector<std::string> RenderedFiles(SourceFiles.size());
+  ThreadPool Pool(NumThreads);
+  for (unsigned I = 0, E = SourceFiles.size(); I < E; ++I)
+    Pool.async([this, I, ShowFilenames, &Coverage, &RenderedFiles]() {
+      raw_string_ostream OS(RenderedFiles[I]);
+      renderSourceFile(SourceFiles[I], *Coverage, ShowFilenames, OS);
+    });
+  Pool.wait();
+
+  for (const auto &Rendered : RenderedFiles)
+    outs() << Rendered;
+
   return 0;
 }
 
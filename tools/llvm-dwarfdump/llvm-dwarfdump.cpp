@@ -32,6 +32,7 @@
 #include <list>
 #include <string>
 #include <system_error>
+#include <thread>
 
 using namespace llvm;
 using namespace object;
@@ -74,6 +75,13 @@ static cl::opt<DIDumpType> DumpType(
         clEnumValN(DIDT_CUIndex, "cu_index", ".debug_cu_index"),
         clEnumValN(DIDT_TUIndex, "tu_index", ".debug_tu_index"), clEnumValEnd));
 
+static cl::opt<unsigned> NumThreads(
+    "num-threads", cl::init(0),
+    cl::desc("Number of threads used to parse the .debug_info and "
+             ".debug_types units (default: autodetect)"));
+static cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                             cl::aliasopt(NumThreads));
+
 static void error(StringRef Filename, std::error_code EC) {
   if (!EC)
     return;
@@ -82,7 +90,20 @@ static void error(StringRef Filename, std::error_code EC) {
 }
 
 static void DumpObjectFile(ObjectFile &Obj, Twine Filename) {
-  std::unique_ptr<DIContext> DICtx(new DWARFContextInMemory(Obj));
+  std::unique_ptr<DWARFContext> DICtx(new DWARFContextInMemory(Obj));
+
+  // Parse the units up front, in parallel, when they are going to be dumped.
+  switch (DumpType) {
+  case DIDT_All:
+  case DIDT_Info:
+  case DIDT_InfoDwo:
+  case DIDT_Types:
+  case DIDT_TypesDwo:
+    DICtx->extractAllDIEs(NumThreads);
+    break;
+  default:
+    break;
+  }
 
   outs() << Filename.str() << ":\tfile format " << Obj.getFileFormatName()
          << "\n\n";
@@ -151,6 +172,8 @@ int main(int argc, char **argv) {
   llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
 
   cl::ParseCommandLineOptions(argc, argv, "llvm dwarf dumper\n");
+  if (NumThreads == 0)
+    NumThreads = std::max(1U, std::thread::hardware_concurrency());
 
   // Defaults to a.out if no filenames specified.
   if (InputFilenames.size() == 0)
@@ -13,16 +13,21 @@
 #include "llvm/MC/MCTargetOptionsCommandFlags.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Options.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <deque>
 #include <list>
 #include <memory>
+#include <thread>
 #include <unordered_set>
 
 using namespace llvm;
@@ -38,53 +43,98 @@ static opt<std::string> OutputFilename(Required, "o",
                                        value_desc("filename"),
                                        cat(DwpCategory));
 
+static opt<unsigned>
+    NumThreads("num-threads",
+               desc("Number of threads used to read the input files "
+                    "(default: autodetect)"),
+               init(0), cat(DwpCategory));
+static alias NumThreadsA("j", desc("Alias for --num-threads"),
+                         aliasopt(NumThreads));
+
 static int error(const Twine &Error, const Twine &Context) {
   errs() << Twine("while processing ") + Context + ":\n";
   errs() << Twine("error: ") + Error + "\n";
   return 1;
 }
 
-static std::error_code
-writeStringsAndOffsets(MCStreamer &Out, StringMap<uint32_t> &Strings,
-                       uint32_t &StringOffset, MCSection *StrSection,
-                       MCSection *StrOffsetSection, StringRef CurStrSection,
-                       StringRef CurStrOffsetSection) {
+/// A section of a .dwo file and where its contents go in the output.
+struct DWOSection {
+  MCSection *OutSection;
+  DWARFSectionKind Kind;
+  StringRef Contents;
+};
+
+struct TypeUnit {
+  uint64_t Signature;
+  uint32_t Offset;
+  uint32_t Length;
+};
+
+/// A .dwo file, mapped and scanned ahead of its turn to be merged into the
+/// output. Everything in here only depends on the file itself, so inputs are
+/// read in parallel; merging them stays in input order, which fixes the
+/// output layout.
+struct DWOInput {
+  std::error_code Err;
+  OwningBinary<ObjectFile> Binary;
+  /// The known sections, in input order.
+  std::vector<DWOSection> Sections;
+  StringRef StrSection;
+  StringRef StrOffsetSection;
+  StringRef TypesSection;
+  uint64_t Signature;
+  /// The strings of StrSection, with their offsets, in section order.
+  std::vector<std::pair<uint32_t, StringRef>> Strings;
+  std::vector<TypeUnit> TypeUnits;
+};
+
+static void writeStringsAndOffsets(MCStreamer &Out,
+                                   StringMap<uint32_t> &Strings,
+                                   uint32_t &StringOffset,
+                                   MCSection *StrSection,
+                                   MCSection *StrOffsetSection,
+                                   const DWOInput &Input) {
   // Could possibly produce an error or warning if one of these was non-null but
   // the other was null.
-  if (CurStrSection.empty() || CurStrOffsetSection.empty())
-    return std::error_code();
-
-  DenseMap<uint32_t, uint32_t> OffsetRemapping;
+  if (Input.StrSection.empty() || Input.StrOffsetSection.empty())
+    return;
 
-  DataExtractor Data(CurStrSection, true, 0);
-  uint32_t LocalOffset = 0;
-  uint32_t PrevOffset = 0;
-  while (const char *s = Data.getCStr(&LocalOffset)) {
-    StringRef Str(s, LocalOffset - PrevOffset - 1);
-    auto Pair = Strings.insert(std::make_pair(Str, StringOffset));
+  // Output offsets of Input.Strings. The strings that are new to the output
+  // are gathered and emitted at once.
+  std::vector<uint32_t> OffsetRemapping;
+  OffsetRemapping.reserve(Input.Strings.size());
+  SmallString<0> NewStrings;
+  for (const auto &Str : Input.Strings) {
+    auto Pair = Strings.insert(std::make_pair(Str.second, StringOffset));
     if (Pair.second) {
-      Out.SwitchSection(StrSection);
-      Out.EmitBytes(
-          StringRef(Pair.first->getKeyData(), Pair.first->getKeyLength() + 1));
-      StringOffset += Str.size() + 1;
+      NewStrings.append(Str.second.begin(), Str.second.end());
+      NewStrings.push_back('\0');
+      StringOffset += Str.second.size() + 1;
     }
-    OffsetRemapping[PrevOffset] = Pair.first->second;
-    PrevOffset = LocalOffset;
+    OffsetRemapping.push_back(Pair.first->second);
   }
+  Out.SwitchSection(StrSection);
+  Out.EmitBytes(NewStrings);
 
-  Data = DataExtractor(CurStrOffsetSection, true, 0);
-
-  Out.SwitchSection(StrOffsetSection);
+  DataExtractor Data(Input.StrOffsetSection, true, 0);
+  SmallString<0> NewOffsets;
+  NewOffsets.reserve(Input.StrOffsetSection.size());
+  raw_svector_ostream OS(NewOffsets);
+  support::endian::Writer<support::little> W(OS);
 
   uint32_t Offset = 0;
-  uint64_t Size = CurStrOffsetSection.size();
-  while (Offset < Size) {
-    auto OldOffset = Data.getU32(&Offset);
-    auto NewOffset = OffsetRemapping[OldOffset];
-    Out.EmitIntValue(NewOffset, 4);
+  while (Data.isValidOffsetForDataOfSize(Offset, 4)) {
+    uint32_t OldOffset = Data.getU32(&Offset);
+    // Offsets that do not start a string are mapped to 0.
+    auto I = std::lower_bound(Input.Strings.begin(), Input.Strings.end(),
+                              std::make_pair(OldOffset, StringRef()));
+    uint32_t NewOffset = 0;
+    if (I != Input.Strings.end() && I->first == OldOffset)
+      NewOffset = OffsetRemapping[I - Input.Strings.begin()];
+    W.write(NewOffset);
   }
-
-  return std::error_code();
+  Out.SwitchSection(StrOffsetSection);
+  Out.EmitBytes(OS.str());
 }
 
 static uint32_t getCUAbbrev(StringRef Abbrev, uint64_t AbbrCode) {
@@ -138,38 +188,46 @@ struct UnitIndexEntry {
   DWARFUnitIndex::Entry::SectionContribution Contributions[8];
 };
 
+static void readTypeUnits(StringRef Types, std::vector<TypeUnit> &Units) {
+  uint32_t Offset = 0;
+  DataExtractor Data(Types, true, 0);
+  while (Data.isValidOffset(Offset)) {
+    TypeUnit TU;
+    TU.Offset = Offset;
+    // Length of the unit, including the 4 byte length field.
+    TU.Length = Data.getU32(&Offset) + 4;
+
+    Data.getU16(&Offset); // Version
+    Data.getU32(&Offset); // Abbrev offset
+    Data.getU8(&Offset);  // Address size
+    TU.Signature = Data.getU64(&Offset);
+    Offset = TU.Offset + TU.Length;
+    Units.push_back(TU);
+  }
+}
+
 static void addAllTypes(MCStreamer &Out,
                         std::vector<UnitIndexEntry> &TypeIndexEntries,
-                        MCSection *OutputTypes, StringRef Types,
+                        std::unordered_set<uint64_t> &TypeSignatures,
+                        MCSection *OutputTypes, const DWOInput &Input,
                         const UnitIndexEntry &CUEntry, uint32_t &TypesOffset) {
-  if (Types.empty())
+  if (Input.TypesSection.empty())
     return;
 
   Out.SwitchSection(OutputTypes);
-  uint32_t Offset = 0;
-  DataExtractor Data(Types, true, 0);
-  while (Data.isValidOffset(Offset)) {
+  for (const TypeUnit &TU : Input.TypeUnits) {
+    if (!TypeSignatures.insert(TU.Signature).second)
+      continue;
+
     UnitIndexEntry Entry = CUEntry;
     // Zero out the debug_info contribution
     Entry.Contributions[0] = {};
     auto &C = Entry.Contributions[DW_SECT_TYPES - DW_SECT_INFO];
     C.Offset = TypesOffset;
-    auto PrevOffset = Offset;
-    // Length of the unit, including the 4 byte length field.
-    C.Length = Data.getU32(&Offset) + 4;
+    C.Length = TU.Length;
+    Entry.Signature = TU.Signature;
 
-    Data.getU16(&Offset); // Version
-    Data.getU32(&Offset); // Abbrev offset
-    Data.getU8(&Offset);  // Address size
-    Entry.Signature = Data.getU64(&Offset);
-    Offset = PrevOffset + C.Length;
-
-    if (any_of(TypeIndexEntries, [&](const UnitIndexEntry &E) {
-          return E.Signature == Entry.Signature;
-        }))
-      continue;
-
-    Out.EmitBytes(Types.substr(PrevOffset, C.Length));
+    Out.EmitBytes(Input.TypesSection.substr(TU.Offset, TU.Length));
     TypesOffset += C.Length;
 
     TypeIndexEntries.push_back(Entry);
@@ -234,12 +292,84 @@ static void writeIndex(MCStreamer &Out, MCSection *Section,
   writeIndexTable(Out, ContributionOffsets, IndexEntries,
                   &DWARFUnitIndex::Entry::SectionContribution::Length);
 }
+typedef StringMap<std::pair<MCSection *, DWARFSectionKind>> KnownSectionsMap;
+
+/// Map \p Filename and collect what merging it needs into \p Input. Runs on
+/// the thread pool: it must not touch the output.
+static void readInput(StringRef Filename, const KnownSectionsMap &KnownSections,
+                      DWOInput &Input) {
+  auto ErrOrObj = object::ObjectFile::createObjectFile(Filename);
+  if (!ErrOrObj) {
+    Input.Err = ErrOrObj.getError();
+    return;
+  }
+  Input.Binary = std::move(*ErrOrObj);
+
+  StringRef InfoSection;
+  StringRef AbbrevSection;
+
+  for (const auto &Section : Input.Binary.getBinary()->sections()) {
+    StringRef Name;
+    if (std::error_code Err = Section.getName(Name)) {
+      Input.Err = Err;
+      return;
+    }
+
+    auto SectionPair =
+        KnownSections.find(Name.substr(Name.find_first_not_of("._")));
+    if (SectionPair == KnownSections.end())
+      continue;
+
+    StringRef Contents;
+    if (auto Err = Section.getContents(Contents)) {
+      Input.Err = Err;
+      return;
+    }
+
+    DWARFSectionKind Kind = SectionPair->second.second;
+    switch (Kind) {
+    case DW_SECT_INFO:
+      InfoSection = Contents;
+      break;
+    case DW_SECT_ABBREV:
+      AbbrevSection = Contents;
+      break;
+    case DW_SECT_TYPES:
+      Input.TypesSection = Contents;
+      break;
+    case DW_SECT_STR_OFFSETS:
+      Input.StrOffsetSection = Contents;
+      break;
+    default:
+      // .debug_str.dwo is the only known section without a kind.
+      if (!Kind)
+        Input.StrSection = Contents;
+      break;
+    }
+    Input.Sections.push_back({SectionPair->second.first, Kind, Contents});
+  }
+
+  assert(!AbbrevSection.empty());
+  assert(!InfoSection.empty());
+  Input.Signature = getCUSignature(AbbrevSection, InfoSection);
+  readTypeUnits(Input.TypesSection, Input.TypeUnits);
+
+  DataExtractor Data(Input.StrSection, true, 0);
+  uint32_t LocalOffset = 0;
+  uint32_t PrevOffset = 0;
+  while (const char *s = Data.getCStr(&LocalOffset)) {
+    Input.Strings.push_back(
+        std::make_pair(PrevOffset, StringRef(s, LocalOffset - PrevOffset - 1)));
+    PrevOffset = LocalOffset;
+  }
+}
+
 static std::error_code write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
   const auto &MCOFI = *Out.getContext().getObjectFileInfo();
   MCSection *const StrSection = MCOFI.getDwarfStrDWOSection();
   MCSection *const StrOffsetSection = MCOFI.getDwarfStrOffDWOSection();
   MCSection *const TypesSection = MCOFI.getDwarfTypesDWOSection();
-  const StringMap<std::pair<MCSection *, DWARFSectionKind>> KnownSections = {
+  const KnownSectionsMap KnownSections = {
       {"debug_info.dwo", {MCOFI.getDwarfInfoDWOSection(), DW_SECT_INFO}},
       {"debug_types.dwo", {MCOFI.getDwarfTypesDWOSection(), DW_SECT_TYPES}},
       {"debug_str_offsets.dwo", {StrOffsetSection, DW_SECT_STR_OFFSETS}},
@@ -250,83 +380,75 @@ static std::error_code write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
 
   std::vector<UnitIndexEntry> IndexEntries;
   std::vector<UnitIndexEntry> TypeIndexEntries;
+  std::unordered_set<uint64_t> TypeSignatures;
 
   StringMap<uint32_t> Strings;
   uint32_t StringOffset = 0;
 
   uint32_t ContributionOffsets[8] = {};
 
-  for (const auto &Input : Inputs) {
-    auto ErrOrObj = object::ObjectFile::createObjectFile(Input);
-    if (!ErrOrObj)
-      return ErrOrObj.getError();
+  // Read the inputs on the pool, up to NumThreads of them ahead of the one
+  // being merged, so that only a bounded number of files is mapped at once.
+  // The pool is destroyed first, so no read outlives its DWOInput.
+  std::deque<std::pair<std::unique_ptr<DWOInput>,
+                       std::shared_future<ThreadPool::VoidTy>>> Pending;
+  std::unique_ptr<ThreadPool> Pool;
+  size_t Lookahead = 0;
+  if (NumThreads > 1) {
+    Pool.reset(new ThreadPool(NumThreads));
+    Lookahead = NumThreads;
+  }
+  size_t NextToRead = 0;
+
+  for (size_t I = 0, E = Inputs.size(); I != E; ++I) {
+    for (; NextToRead != E && NextToRead <= I + Lookahead; ++NextToRead) {
+      std::unique_ptr<DWOInput> In(new DWOInput());
+      std::shared_future<ThreadPool::VoidTy> Read;
+      if (Pool) {
+        DWOInput *InPtr = In.get();
+        StringRef Name = Inputs[NextToRead];
+        Read = Pool->async(
+            [=, &KnownSections] { readInput(Name, KnownSections, *InPtr); });
+      } else {
+        readInput(Inputs[NextToRead], KnownSections, *In);
+      }
+      Pending.emplace_back(std::move(In), std::move(Read));
+    }
+
+    std::unique_ptr<DWOInput> Input = std::move(Pending.front().first);
+    if (Pending.front().second.valid())
+      Pending.front().second.wait();
+    Pending.pop_front();
+    if (Input->Err)
+      return Input->Err;
 
     IndexEntries.emplace_back();
     UnitIndexEntry &CurEntry = IndexEntries.back();
+    CurEntry.Signature = Input->Signature;
 
-    StringRef CurStrSection;
-    StringRef CurStrOffsetSection;
-    StringRef CurTypesSection;
-    StringRef InfoSection;
-    StringRef AbbrevSection;
-
-    for (const auto &Section : ErrOrObj->getBinary()->sections()) {
-      StringRef Name;
-      if (std::error_code Err = Section.getName(Name))
-        return Err;
-
-      auto SectionPair =
-          KnownSections.find(Name.substr(Name.find_first_not_of("._")));
-      if (SectionPair == KnownSections.end())
-        continue;
-
-      StringRef Contents;
-      if (auto Err = Section.getContents(Contents))
-        return Err;
-
-      if (DWARFSectionKind Kind = SectionPair->second.second) {
+    for (const DWOSection &Section : Input->Sections) {
+      if (DWARFSectionKind Kind = Section.Kind) {
         auto Index = Kind - DW_SECT_INFO;
         if (Kind != DW_SECT_TYPES) {
           CurEntry.Contributions[Index].Offset = ContributionOffsets[Index];
           ContributionOffsets[Index] +=
-              (CurEntry.Contributions[Index].Length = Contents.size());
-        }
-
-        switch (Kind) {
-        case DW_SECT_INFO:
-          InfoSection = Contents;
-          break;
-        case DW_SECT_ABBREV:
-          AbbrevSection = Contents;
-          break;
-        default:
-          break;
+              (CurEntry.Contributions[Index].Length = Section.Contents.size());
         }
       }
 
-      MCSection *OutSection = SectionPair->second.first;
-      if (OutSection == StrOffsetSection)
-        CurStrOffsetSection = Contents;
-      else if (OutSection == StrSection)
-        CurStrSection = Contents;
-      else if (OutSection == TypesSection)
-        CurTypesSection = Contents;
-      else {
+      MCSection *OutSection = Section.OutSection;
+      if (OutSection != StrOffsetSection && OutSection != StrSection &&
+          OutSection != TypesSection) {
         Out.SwitchSection(OutSection);
-        Out.EmitBytes(Contents);
+        Out.EmitBytes(Section.Contents);
       }
     }
 
-    assert(!AbbrevSection.empty());
-    assert(!InfoSection.empty());
-    CurEntry.Signature = getCUSignature(AbbrevSection, InfoSection);
-    addAllTypes(Out, TypeIndexEntries, TypesSection, CurTypesSection, CurEntry,
-                ContributionOffsets[DW_SECT_TYPES - DW_SECT_INFO]);
+    addAllTypes(Out, TypeIndexEntries, TypeSignatures, TypesSection, *Input,
+                CurEntry, ContributionOffsets[DW_SECT_TYPES - DW_SECT_INFO]);
 
-    if (auto Err = writeStringsAndOffsets(Out, Strings, StringOffset,
-                                          StrSection, StrOffsetSection,
-                                          CurStrSection, CurStrOffsetSection))
-      return Err;
+    writeStringsAndOffsets(Out, Strings, StringOffset, StrSection,
+                           StrOffsetSection, *Input);
   }
 
   if (!TypeIndexEntries.empty()) {
@@ -351,6 +473,8 @@ static std::error_code write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
 int main(int argc, char **argv) {
 
   ParseCommandLineOptions(argc, argv, "merge split dwarf (.dwo) files");
+  if (NumThreads == 0)
+    NumThreads = std::max(1U, std::thread::hardware_concurrency());
 
   llvm::InitializeAllTargetInfos();
   llvm::InitializeAllTargetMCs();
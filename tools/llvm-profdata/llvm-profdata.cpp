@@ -28,8 +28,11 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <mutex>
+#include <thread>
 #include <tuple>
 
 using namespace llvm;
@@ -105,9 +108,87 @@ struct WeightedFile {
 };
 typedef SmallVector<WeightedFile, 5> WeightedFileVector;
 
+/// The merged profile of a subset of the inputs, built by one merge thread.
+struct WriterContext {
+  std::mutex Lock;
+  InstrProfWriter Writer;
+  /// The first error that prevented an input from being read, if any.
+  std::error_code Err;
+  StringRef ErrWhence;
+  /// Merge warnings are printed under ErrLock; WriterErrorCodes remembers
+  /// which errors have already been shown with a hint.
+  std::mutex &ErrLock;
+  SmallSet<std::error_code, 4> &WriterErrorCodes;
+
+  WriterContext(std::mutex &ErrLock,
+                SmallSet<std::error_code, 4> &WriterErrorCodes)
+      : ErrLock(ErrLock), WriterErrorCodes(WriterErrorCodes) {}
+
+  void warn(std::error_code EC, StringRef WhenceFile,
+            StringRef WhenceFunction) {
+    std::lock_guard<std::mutex> Guard(ErrLock);
+    // Only show hint the first time an error occurs.
+    bool FirstTime = WriterErrorCodes.insert(EC).second;
+    handleMergeWriterError(EC, WhenceFile, WhenceFunction, FirstTime);
+  }
+};
+
+/// Read \p Input and merge its records into \p WC's writer.
+static void loadInput(const WeightedFile &Input, WriterContext *WC) {
+  std::lock_guard<std::mutex> Guard(WC->Lock);
+
+  // Once an input of this context has failed we will exit anyway.
+  if (WC->Err)
+    return;
+
+  WC->ErrWhence = Input.Filename;
+  auto ReaderOrErr = InstrProfReader::create(Input.Filename);
+  if ((WC->Err = ReaderOrErr.getError()))
+    return;
+
+  auto Reader = std::move(ReaderOrErr.get());
+  for (auto &I : *Reader)
+    if (std::error_code EC = WC->Writer.addRecord(std::move(I), Input.Weight)) {
+      // Anything but a merge conflict is a failure to spill to disk.
+      if (EC.category() != instrprof_category()) {
+        WC->Err = EC;
+        return;
+      }
+      WC->warn(EC, Input.Filename, I.Name);
+    }
+  if (Reader->hasError())
+    WC->Err = Reader->getError();
+}
+
+/// Merge the records of \p Src into \p Dst.
+static void mergeWriterContexts(WriterContext *Dst, WriterContext *Src) {
+  Dst->Writer.mergeRecordsFromWriter(
+      std::move(Src->Writer),
+      [&](std::error_code EC, StringRef FuncName) {
+        if (EC.category() != instrprof_category()) {
+          if (!Dst->Err) {
+            Dst->Err = EC;
+            Dst->ErrWhence = "";
+          }
+          return;
+        }
+        Dst->warn(EC, "", FuncName);
+      });
+}
+
+/// Destroy the writers before exiting with \p EC, as exiting skips the
+/// destructors that remove their spilled runs.
+static void
+exitWithWriterError(SmallVectorImpl<std::unique_ptr<WriterContext>> &Contexts,
+                    std::error_code EC, StringRef Whence) {
+  Contexts.clear();
+  exitWithErrorCode(EC, Whence);
+}
+
 static void mergeInstrProfile(const WeightedFileVector &Inputs,
                               StringRef OutputFilename,
-                              ProfileFormat OutputFormat) {
+                              ProfileFormat OutputFormat,
+                              unsigned NumThreads, uint64_t MemoryLimitMB) {
   if (OutputFilename.compare("-") == 0)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
@@ -119,28 +200,70 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
   if (EC)
     exitWithErrorCode(EC, OutputFilename);
 
-  InstrProfWriter Writer;
+  // Each thread merges into a writer of its own, which costs memory
+  // proportional to the merged profile, so use no more threads than there
+  // are pairs of inputs.
+  if (NumThreads == 0)
+    NumThreads = std::max(1U, std::min(std::thread::hardware_concurrency(),
+                                       unsigned((Inputs.size() + 1) / 2)));
+
+  std::mutex ErrLock;
   SmallSet<std::error_code, 4> WriterErrorCodes;
-  for (const auto &Input : Inputs) {
-    auto ReaderOrErr = InstrProfReader::create(Input.Filename);
-    if (std::error_code ec = ReaderOrErr.getError())
-      exitWithErrorCode(ec, Input.Filename);
-
-    auto Reader = std::move(ReaderOrErr.get());
-    for (auto &I : *Reader) {
-      if (std::error_code EC = Writer.addRecord(std::move(I), Input.Weight)) {
-        // Only show hint the first time an error occurs.
-        bool firstTime = WriterErrorCodes.insert(EC).second;
-        handleMergeWriterError(EC, Input.Filename, I.Name, firstTime);
-      }
+  SmallVector<std::unique_ptr<WriterContext>, 4> Contexts;
+  for (unsigned I = 0; I < NumThreads; ++I) {
+    Contexts.emplace_back(
+        llvm::make_unique<WriterContext>(ErrLock, WriterErrorCodes));
+    // Split the memory budget between the contexts. Records that spill to
+    // disk are only merged, and checked, when the output is written.
+    if (MemoryLimitMB) {
+      WriterContext *WC = Contexts.back().get();
+      WC->Writer.setMemoryLimit(
+          std::max<uint64_t>(1, (MemoryLimitMB << 20) / NumThreads),
+          [WC](std::error_code EC, StringRef FuncName) {
+            WC->warn(EC, "", FuncName);
+          });
     }
-    if (Reader->hasError())
-      exitWithErrorCode(Reader->getError(), Input.Filename);
   }
-  if (OutputFormat == PF_Text)
-    Writer.writeText(Output);
-  else
-    Writer.write(Output);
+
+  if (NumThreads == 1) {
+    for (const auto &Input : Inputs)
+      loadInput(Input, Contexts[0].get());
+  } else {
+    ThreadPool Pool(NumThreads);
+
+    // Load the inputs in parallel, spreading them over the contexts.
+    unsigned Ctx = 0;
+    for (const auto &Input : Inputs) {
+      Pool.async(loadInput, Input, Contexts[Ctx].get());
+      Ctx = (Ctx + 1) % NumThreads;
+    }
+    Pool.wait();
+
+    // Reduce the contexts pairwise into the first one.
+    unsigned Mid = Contexts.size() / 2;
+    unsigned End = Contexts.size();
+    assert(Mid > 0 && "Expected more than one context");
+    do {
+      for (unsigned I = 0; I < Mid; ++I)
+        Pool.async(mergeWriterContexts, Contexts[I].get(),
+                   Contexts[I + Mid].get());
+      Pool.wait();
+      if (End & 1)
+        mergeWriterContexts(Contexts[0].get(), Contexts[End - 1].get());
+      End = Mid;
+      Mid /= 2;
+    } while (Mid > 0);
+  }
+
+  // Report the errors that stopped an input from being read.
+  for (const auto &WC : Contexts)
+    if (WC->Err)
+      exitWithWriterError(Contexts, WC->Err, WC->ErrWhence);
+
+  InstrProfWriter &Writer = Contexts[0]->Writer;
+  if (std::error_code EC = OutputFormat == PF_Text ? Writer.writeText(Output)
+                                                   : Writer.write(Output))
+    exitWithWriterError(Contexts, EC, OutputFilename);
 }
 
 static sampleprof::SampleProfileFormat FormatMap[] = {
@@ -228,6 +351,17 @@ static int merge_main(int argc, const char *argv[]) {
                             "GCC encoding (only meaningful for -sample)"),
                  clEnumValEnd));
 
+  cl::opt<unsigned> NumThreads(
+      "num-threads", cl::init(0),
+      cl::desc("Number of merge threads to use (default: autodetect)"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads));
+  cl::opt<unsigned> MemoryLimitMB(
+      "memory-limit", cl::init(0), cl::value_desc("megabytes"),
+      cl::desc("Approximate memory to use for merged instrumentation "
+               "records before spilling them to temporary files "
+               "(default: no limit)"));
+
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
   if (InputFilenames.empty() && WeightedInputFilenames.empty())
@@ -241,7 +375,8 @@ static int merge_main(int argc, const char *argv[]) {
     WeightedInputs.push_back(parseWeightedFile(WeightedFilename));
 
   if (ProfileKind == instr)
-    mergeInstrProfile(WeightedInputs, OutputFilename, OutputFormat);
+    mergeInstrProfile(WeightedInputs, OutputFilename, OutputFormat,
+                      NumThreads, MemoryLimitMB);
   else
     mergeSampleProfile(WeightedInputs, OutputFilename, OutputFormat);
 
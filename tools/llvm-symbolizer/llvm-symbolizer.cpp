@@ -16,6 +16,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/DebugInfo/Symbolize/DIPrinter.h"
 #include "llvm/DebugInfo/Symbolize/Symbolize.h"
 #include "llvm/Support/COM.h"
@@ -28,8 +29,10 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
+#include <algorithm>
 #include <cstring>
 #include <string>
+#include <thread>
 
 using namespace llvm;
 using namespace symbolize;
@@ -86,6 +89,17 @@ static cl::opt<int> ClPrintSourceContextLines(
     "print-source-context-lines", cl::init(0),
     cl::desc("Print N number of source file context"));
 
+static cl::opt<bool>
+    ClBatch("batch", cl::init(false),
+            cl::desc("Read the whole input before symbolizing it, and "
+                     "symbolize it on several threads"));
+
+static cl::opt<unsigned> ClNumThreads(
+    "num-threads", cl::init(0),
+    cl::desc("Number of threads to use in -batch mode (default: autodetect)"));
+static cl::alias ClNumThreadsA("j", cl::desc("Alias for --num-threads"),
+                               cl::aliasopt(ClNumThreads));
+
 static bool error(std::error_code ec) {
   if (!ec)
     return false;
@@ -136,6 +150,88 @@ static bool parseCommand(StringRef InputString, bool &IsData,
   return !StringRef(pos, offset_length).getAsInteger(0, ModuleOffset);
 }
 
+static void printAddress(uint64_t ModuleOffset) {
+  if (ClPrintAddress) {
+    outs() << "0x";
+    outs().write_hex(ModuleOffset);
+    StringRef Delimiter = (ClPrettyPrint == true) ? ": " : "\n";
+    outs() << Delimiter;
+  }
+}
+
+// Symbolize input in chunks of this many lines, so that the results of a huge
+// input do not have to be held in memory all at once.
+static const size_t kBatchChunkLines = 1 << 20;
+
+static void symbolizeInBatches(LLVMSymbolizer &Symbolizer,
+                               DIPrinter &Printer) {
+  unsigned NumThreads = ClNumThreads;
+  if (NumThreads == 0)
+    NumThreads = std::max(1U, std::thread::hardware_concurrency());
+
+  const int kMaxInputStringLength = 1024;
+  char InputString[kMaxInputStringLength];
+  // Module names are interned here; requests refer to them by StringRef.
+  StringSet<> ModuleNames;
+  bool AtEOF = false;
+  while (!AtEOF) {
+    // Each input line is either a request, or a string to echo if it could not
+    // be parsed.
+    std::vector<LLVMSymbolizer::BatchRequest> Requests;
+    std::vector<std::string> Unparsed;
+    std::vector<std::pair<bool, size_t>> Lines;
+    while (Lines.size() < kBatchChunkLines) {
+      if (!fgets(InputString, sizeof(InputString), stdin)) {
+        AtEOF = true;
+        break;
+      }
+      bool IsData = false;
+      std::string ModuleName;
+      uint64_t ModuleOffset = 0;
+      if (!parseCommand(StringRef(InputString), IsData, ModuleName,
+                        ModuleOffset)) {
+        Lines.push_back(std::make_pair(false, Unparsed.size()));
+        Unparsed.push_back(InputString);
+        continue;
+      }
+      auto Kind = IsData ? LLVMSymbolizer::BatchRequest::Data
+                         : ClPrintInlining
+                               ? LLVMSymbolizer::BatchRequest::InlinedCode
+                               : LLVMSymbolizer::BatchRequest::Code;
+      StringRef Name = ModuleNames.insert(ModuleName).first->getKey();
+      Lines.push_back(std::make_pair(true, Requests.size()));
+      Requests.push_back(
+          LLVMSymbolizer::BatchRequest(Kind, Name, ModuleOffset));
+    }
+
+    std::vector<LLVMSymbolizer::BatchResult> Results =
+        Symbolizer.symbolizeBatch(Requests, NumThreads);
+    for (const auto &Line : Lines) {
+      if (!Line.first) {
+        outs() << Unparsed[Line.second];
+        continue;
+      }
+      const LLVMSymbolizer::BatchRequest &Request = Requests[Line.second];
+      const LLVMSymbolizer::BatchResult &Result = Results[Line.second];
+      printAddress(Request.ModuleOffset);
+      bool Failed = error(Result.EC);
+      switch (Request.Kind) {
+      case LLVMSymbolizer::BatchRequest::Data:
+        Printer << (Failed ? DIGlobal() : Result.Global);
+        break;
+      case LLVMSymbolizer::BatchRequest::InlinedCode:
+        Printer << (Failed ? DIInliningInfo() : Result.InliningInfo);
+        break;
+      case LLVMSymbolizer::BatchRequest::Code:
+        Printer << (Failed ? DILineInfo() : Result.LineInfo);
+        break;
+      }
+      outs() << "\n";
+    }
+    outs().flush();
+  }
+}
+
 int main(int argc, char **argv) {
   // Print stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -161,6 +257,11 @@ int main(int argc, char **argv) {
   DIPrinter Printer(outs(), ClPrintFunctions != FunctionNameKind::None,
                     ClPrettyPrint, ClPrintSourceContextLines);
 
+  if (ClBatch) {
+    symbolizeInBatches(Symbolizer, Printer);
+    return 0;
+  }
+
   const int kMaxInputStringLength = 1024;
   char InputString[kMaxInputStringLength];
 
@@ -177,12 +278,7 @@ int main(int argc, char **argv) {
       continue;
     }
 
-    if (ClPrintAddress) {
-      outs() << "0x";
-      outs().write_hex(ModuleOffset);
-      StringRef Delimiter = (ClPrettyPrint == true) ? ": " : "\n";
-      outs() << Delimiter;
-    }
+    printAddress(ModuleOffset);
     if (IsData) {
       auto ResOrErr = Symbolizer.symbolizeData(ModuleName, ModuleOffset);
       Printer << (error(ResOrErr.getError()) ? DIGlobal() : ResOrErr.get());
@@ -47,6 +47,50 @@ TEST(MCJITMemoryManagerTest, BasicAllocations) {
   EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
 }
 
+TEST(MCJITMemoryManagerTest, SlabAllocations) {
+  const uintptr_t SlabSize = 0x100000;
+  std::unique_ptr<SectionMemoryManager> MemMgr(
+      new SectionMemoryManager(SlabSize));
+
+  // Both code sections should come out of the first code slab.
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 2, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 3, "", false);
+
+  EXPECT_NE((uint8_t*)nullptr, code1);
+  EXPECT_NE((uint8_t*)nullptr, code2);
+  EXPECT_NE((uint8_t*)nullptr, data1);
+  EXPECT_LT((uintptr_t)(code2 > code1 ? code2 - code1 : code1 - code2),
+            SlabSize);
+
+  for (unsigned i = 0; i < 256; ++i) {
+    code1[i] = 1;
+    code2[i] = 2;
+    data1[i] = 3;
+  }
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  // After finalization the partially used page is off limits, but the rest of
+  // the slab is still used for new sections.
+  uint8_t *code3 = MemMgr->allocateCodeSection(256, 0, 4, "");
+  EXPECT_NE((uint8_t*)nullptr, code3);
+  EXPECT_LT((uintptr_t)(code3 > code1 ? code3 - code1 : code1 - code3),
+            SlabSize);
+  for (unsigned i = 0; i < 256; ++i)
+    code3[i] = 4;
+
+  for (unsigned i = 0; i < 256; ++i) {
+    EXPECT_EQ(1, code1[i]);
+    EXPECT_EQ(2, code2[i]);
+    EXPECT_EQ(3, data1[i]);
+    EXPECT_EQ(4, code3[i]);
+  }
+
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+}
+
 TEST(MCJITMemoryManagerTest, LargeAllocations) {
   std::unique_ptr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
 
@@ -13,12 +13,26 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "MCJITTestBase.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
 
+// The debugger interface of GDBRegistrationListener.
+extern "C" {
+struct jit_code_entry;
+struct jit_descriptor {
+  uint32_t version;
+  uint32_t action_flag;
+  jit_code_entry *relevant_entry;
+  jit_code_entry *first_entry;
+};
+extern jit_descriptor __jit_debug_descriptor;
+void __llvm_jit_debug_register_deferred();
+}
+
 namespace {
 
 class MCJITTest : public testing::Test, public MCJITTestBase {
@@ -281,4 +295,26 @@ TEST_F(MCJITTest, lazy_function_creator_lambda) {
   EXPECT_FALSE(std::find(I, E, "Foo2") == E);
 }
 
+TEST_F(MCJITTest, deferred_debug_registration) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  auto *Defer = static_cast<cl::opt<bool> *>(
+      cl::getRegisteredOptions()["jit-debug-defer-registration"]);
+  ASSERT_TRUE(Defer != nullptr);
+  *Defer = true;
+
+  Function *Main = insertMainFunction(M.get(), 6);
+  createJIT(std::move(M));
+  EXPECT_TRUE(0 != TheJIT->getFunctionAddress(Main->getName().str()));
+
+  // The emitted object is only announced to the debugger on request.
+  EXPECT_TRUE(__jit_debug_descriptor.first_entry == nullptr);
+  __llvm_jit_debug_register_deferred();
+  EXPECT_TRUE(__jit_debug_descriptor.first_entry != nullptr);
+
+  *Defer = false;
+  TheJIT.reset();
+  EXPECT_TRUE(__jit_debug_descriptor.first_entry == nullptr);
+}
+
 } // end anonymous namespace
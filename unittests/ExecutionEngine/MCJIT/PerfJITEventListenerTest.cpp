@@ -0,0 +1,110 @@
+//===- PerfJITEventListenerTest.cpp - Unit tests for the perf listener ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This test checks the jitdump file that PerfJITEventListener writes for code
+// emitted by MCJIT.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "MCJITTestBase.h"
+#include "gtest/gtest.h"
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+using namespace llvm;
+
+namespace {
+
+template <typename T> T readAt(StringRef Data, size_t Offset) {
+  T Value;
+  memcpy(&Value, Data.data() + Offset, sizeof(T));
+  return Value;
+}
+
+class PerfJITEventListenerTest : public testing::Test, public MCJITTestBase {
+protected:
+  void SetUp() override { M.reset(createEmptyModule("<main>")); }
+};
+
+TEST_F(PerfJITEventListenerTest, jitdump_code_load) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  SmallString<128> Dir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("perf-jit-test", Dir));
+  ::setenv("JITDUMPDIR", Dir.c_str(), 1);
+  std::unique_ptr<JITEventListener> Listener(
+      JITEventListener::createPerfJITEventListener());
+  ::unsetenv("JITDUMPDIR");
+  ASSERT_TRUE(Listener != nullptr);
+
+  Function *Main = insertMainFunction(M.get(), 6);
+  createJIT(std::move(M));
+  TheJIT->RegisterJITEventListener(Listener.get());
+  uint64_t Addr = TheJIT->getFunctionAddress(Main->getName().str());
+  ASSERT_TRUE(Addr != 0);
+  TheJIT->UnregisterJITEventListener(Listener.get());
+  // Closes the dump.
+  Listener.reset();
+
+  uint32_t Pid = static_cast<uint32_t>(::getpid());
+  SmallString<128> DumpPath(Dir);
+  sys::path::append(DumpPath, "jit-" + Twine(Pid) + ".dump");
+  ErrorOr<std::unique_ptr<MemoryBuffer>> DumpOrErr =
+      MemoryBuffer::getFile(DumpPath);
+  sys::fs::remove(DumpPath);
+  sys::fs::remove(Dir);
+  sys::fs::remove("/tmp/perf-" + Twine(Pid) + ".map");
+  ASSERT_FALSE(DumpOrErr.getError());
+  StringRef Dump = DumpOrErr.get()->getBuffer();
+
+  // The file header.
+  ASSERT_GE(Dump.size(), 40U);
+  EXPECT_EQ(0x4A695444U, readAt<uint32_t>(Dump, 0)); // Magic
+  EXPECT_EQ(1U, readAt<uint32_t>(Dump, 4));          // Version
+  uint32_t HeaderSize = readAt<uint32_t>(Dump, 8);
+  EXPECT_EQ(40U, HeaderSize);
+  EXPECT_EQ(Pid, readAt<uint32_t>(Dump, 20));
+
+  // Find the code load record of main, which carries a copy of its code.
+  bool FoundMain = false;
+  uint32_t LastId = ~0U;
+  for (size_t Offset = HeaderSize; Offset + 16 <= Dump.size();) {
+    uint32_t Id = readAt<uint32_t>(Dump, Offset);
+    uint32_t Size = readAt<uint32_t>(Dump, Offset + 4);
+    ASSERT_GE(Size, 16U);
+    ASSERT_LE(Offset + Size, Dump.size());
+    LastId = Id;
+    if (Id == 0) { // CodeLoad
+      EXPECT_EQ(Pid, readAt<uint32_t>(Dump, Offset + 16));
+      uint64_t CodeAddr = readAt<uint64_t>(Dump, Offset + 32);
+      uint64_t CodeSize = readAt<uint64_t>(Dump, Offset + 40);
+      StringRef Name(Dump.data() + Offset + 56);
+      ASSERT_EQ(Offset + 56 + Name.size() + 1 + CodeSize, Offset + Size);
+      if (Name == "main") {
+        FoundMain = true;
+        EXPECT_EQ(Addr, CodeAddr);
+        EXPECT_NE(0U, CodeSize);
+        EXPECT_EQ(0, memcmp(Dump.data() + Offset + 56 + Name.size() + 1,
+                            reinterpret_cast<const void *>(CodeAddr),
+                            CodeSize));
+      }
+    }
+    Offset += Size;
+  }
+  EXPECT_TRUE(FoundMain);
+  EXPECT_EQ(3U, LastId); // CodeClose
+}
+
+} // end anonymous namespace
@@ -72,4 +72,40 @@ TEST(CompileOnDemandLayerTest, FindSymbol) {
     << "CompileOnDemand::findSymbol should call findSymbol in the base layer.";
 }
 
+TEST(CompileOnDemandLayerTest, CompileWithDirectCallees) {
+  LLVMContext Context;
+  ModuleBuilder MB(Context, "", "dummy");
+
+  // Callee defined in the module: should be compiled along with the caller.
+  Function *Callee = MB.createFunctionDecl<void()>("callee");
+  IRBuilder<> B(BasicBlock::Create(Context, "entry", Callee));
+  B.CreateRetVoid();
+
+  // External declaration: has no body to compile.
+  Function *Ext = MB.createFunctionDecl<void()>("ext");
+
+  Function *Caller = MB.createFunctionDecl<void()>("caller");
+  B.SetInsertPoint(BasicBlock::Create(Context, "entry", Caller));
+  B.CreateCall(Callee);
+  B.CreateCall(Ext);
+  B.CreateRetVoid();
+
+  auto MockBaseLayer =
+    createMockBaseLayer<int>(DoNothingAndReturn<int>(0),
+                             DoNothingAndReturn<void>(),
+                             DoNothingAndReturn<JITSymbol>(nullptr),
+                             DoNothingAndReturn<JITSymbol>(nullptr));
+
+  typedef llvm::orc::CompileOnDemandLayer<decltype(MockBaseLayer)> CODLayerT;
+
+  auto Part = CODLayerT::compileWithDirectCallees(*Caller);
+  EXPECT_EQ(2U, Part.size()) << "Expected caller and defined callee";
+  EXPECT_TRUE(Part.count(Caller)) << "Requested function missing";
+  EXPECT_TRUE(Part.count(Callee)) << "Defined callee missing";
+  EXPECT_FALSE(Part.count(Ext)) << "Declarations can't be compiled";
+
+  auto Single = CODLayerT::compileRequested(*Caller);
+  EXPECT_EQ(1U, Single.size()) << "Expected requested function only";
+}
+
 }
@@ -0,0 +1,62 @@
+//===- DirectoryObjectCacheTest.cpp - Unit tests for DirectoryObjectCache -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "OrcTestCommon.h"
+#include "llvm/ExecutionEngine/Orc/DirectoryObjectCache.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+TEST(DirectoryObjectCacheTest, RoundTripAndKeying) {
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("orc-object-cache", CacheDir));
+
+  LLVMContext Context;
+  ModuleBuilder MB(Context, "", "dummy");
+  Function *F = MB.createFunctionDecl<void()>("foo");
+  IRBuilder<> B(BasicBlock::Create(Context, "entry", F));
+  B.CreateRetVoid();
+  Module &M = *MB.getModule();
+
+  DirectoryObjectCache Cache(CacheDir.str(), "O2");
+  EXPECT_EQ(nullptr, Cache.getObject(&M)) << "Cache should start out empty";
+
+  StringRef ObjBytes("not really an object");
+  Cache.notifyObjectCompiled(&M, MemoryBufferRef(ObjBytes, "obj"));
+
+  auto Obj = Cache.getObject(&M);
+  ASSERT_NE(nullptr, Obj) << "Object should have been cached";
+  EXPECT_EQ(ObjBytes, Obj->getBuffer()) << "Cached object contents differ";
+
+  // A second cache over the same directory sees the object, as a restarted
+  // process would, but only with the same configuration key.
+  DirectoryObjectCache SameKey(CacheDir.str(), "O2");
+  EXPECT_NE(nullptr, SameKey.getObject(&M)) << "Object should persist";
+  DirectoryObjectCache OtherKey(CacheDir.str(), "O0");
+  EXPECT_EQ(nullptr, OtherKey.getObject(&M))
+    << "Objects must not be shared across configurations";
+
+  // Changing the IR must miss the cache.
+  MB.createFunctionDecl<void()>("bar");
+  EXPECT_EQ(nullptr, Cache.getObject(&M))
+    << "Objects must not be shared across different modules";
+
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC))
+    sys::fs::remove(I->path());
+  sys::fs::remove(CacheDir);
+}
+
+}
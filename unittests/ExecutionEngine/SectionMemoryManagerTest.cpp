@@ -0,0 +1,134 @@
+//===- SectionMemoryManagerTest.cpp - Unit tests for SectionMemoryManager -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+#include <cstring>
+#include <fstream>
+#include <tuple>
+
+using namespace llvm;
+
+namespace {
+
+// Returns the permissions of the mapping that contains Addr, in the "rwxp"
+// form used by /proc/self/maps, or an empty string if they are not known.
+static std::string getPermissions(const void *Addr) {
+#if defined(__linux__)
+  // /proc files report a size of zero, so read the maps line by line.
+  std::ifstream Maps("/proc/self/maps");
+  std::string Entry;
+  while (std::getline(Maps, Entry)) {
+    StringRef Line(Entry), Range, Perms;
+    std::tie(Range, Line) = Line.split(' ');
+    std::tie(Perms, Line) = Line.split(' ');
+    StringRef StartStr, EndStr;
+    std::tie(StartStr, EndStr) = Range.split('-');
+    uint64_t Start, End;
+    if (StartStr.getAsInteger(16, Start) || EndStr.getAsInteger(16, End))
+      continue;
+    if (Start <= (uintptr_t)Addr && (uintptr_t)Addr < End)
+      return Perms.substr(0, 3);
+  }
+#endif
+  return "";
+}
+
+static uintptr_t pageOf(const void *Addr) {
+  static const uintptr_t PageSize = sys::Process::getPageSize();
+  return (uintptr_t)Addr & ~(PageSize - 1);
+}
+
+TEST(SectionMemoryManagerTest, SmallSectionsOnOnePage) {
+  SectionMemoryManager MemMgr;
+
+  // The first allocation maps a page; the rest is carved out of it.
+  uint8_t *Code[4];
+  for (unsigned I = 0; I < 4; ++I) {
+    Code[I] = MemMgr.allocateCodeSection(64, 16, I, "");
+    ASSERT_NE((uint8_t *)nullptr, Code[I]);
+    EXPECT_EQ(pageOf(Code[0]), pageOf(Code[I]));
+    EXPECT_EQ(0U, (uintptr_t)Code[I] % 16);
+    memset(Code[I], I + 1, 64);
+  }
+  uint8_t *ROData = MemMgr.allocateDataSection(64, 8, 4, "", true);
+  uint8_t *RWData = MemMgr.allocateDataSection(64, 8, 5, "", false);
+  ASSERT_NE((uint8_t *)nullptr, ROData);
+  ASSERT_NE((uint8_t *)nullptr, RWData);
+  memset(ROData, 5, 64);
+  memset(RWData, 6, 64);
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error)) << Error;
+
+  for (unsigned I = 0; I < 4; ++I)
+    for (unsigned J = 0; J < 64; ++J)
+      EXPECT_EQ(I + 1, Code[I][J]);
+
+  std::string CodePerms = getPermissions(Code[0]);
+  if (CodePerms.empty())
+    return;
+  EXPECT_EQ("r-x", CodePerms);
+  EXPECT_EQ("r-x", getPermissions(ROData));
+  EXPECT_EQ("rw-", getPermissions(RWData));
+
+  // The rest of the finalized page is not handed out again, so a new code
+  // section goes to a new page that stays writable until it is finalized.
+  uint8_t *Code2 = MemMgr.allocateCodeSection(64, 16, 6, "");
+  ASSERT_NE((uint8_t *)nullptr, Code2);
+  EXPECT_NE(pageOf(Code[0]), pageOf(Code2));
+  EXPECT_EQ("rw-", getPermissions(Code2));
+  memset(Code2, 7, 64);
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error)) << Error;
+  EXPECT_EQ("r-x", getPermissions(Code2));
+  EXPECT_EQ("r-x", getPermissions(Code[0]));
+}
+
+TEST(SectionMemoryManagerTest, SlabSectionsOnOnePage) {
+  static const uintptr_t PageSize = sys::Process::getPageSize();
+  SectionMemoryManager MemMgr(16 * PageSize);
+
+  // With a slab, sections that straddle a page boundary are protected as one
+  // run together with their neighbours.
+  uint8_t *Code[8];
+  for (unsigned I = 0; I < 8; ++I) {
+    Code[I] = MemMgr.allocateCodeSection(PageSize / 3, 16, I, "");
+    ASSERT_NE((uint8_t *)nullptr, Code[I]);
+    memset(Code[I], I + 1, PageSize / 3);
+  }
+  uint8_t *RWData = MemMgr.allocateDataSection(64, 8, 8, "", false);
+  ASSERT_NE((uint8_t *)nullptr, RWData);
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error)) << Error;
+
+  for (unsigned I = 0; I < 8; ++I)
+    EXPECT_EQ(I + 1, Code[I][PageSize / 3 - 1]);
+
+  if (getPermissions(Code[0]).empty())
+    return;
+  for (unsigned I = 0; I < 8; ++I) {
+    EXPECT_EQ("r-x", getPermissions(Code[I]));
+    EXPECT_EQ("r-x", getPermissions(Code[I] + PageSize / 3 - 1));
+  }
+  EXPECT_EQ("rw-", getPermissions(RWData));
+
+  // The untouched pages of the slab are still writable and are used for the
+  // next section.
+  uint8_t *Code2 = MemMgr.allocateCodeSection(64, 16, 9, "");
+  ASSERT_NE((uint8_t *)nullptr, Code2);
+  EXPECT_LT((uintptr_t)(Code2 - Code[0]), 16 * PageSize);
+  EXPECT_EQ("rw-", getPermissions(Code2));
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error)) << Error;
+  EXPECT_EQ("r-x", getPermissions(Code2));
+}
+
+} // end anonymous namespace
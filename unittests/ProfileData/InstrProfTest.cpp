@@ -7,14 +7,17 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProfWriter.h"
 #include "llvm/Support/Compression.h"
+#include "llvm/Support/FileSystem.h"
 #include "gtest/gtest.h"
 
+#include <algorithm>
 #include <cstdarg>
 
 using namespace llvm;
@@ -125,6 +128,50 @@ TEST_F(InstrProfTest, get_function_counts) {
   ASSERT_TRUE(ErrorEquals(instrprof_error::unknown_function, EC));
 }
 
+TEST_F(InstrProfTest, get_function_counts_skips_value_data) {
+  InstrProfRecord Record1("caller", 0x1234, {1, 2});
+  InstrProfRecord Record2("caller", 0x1235, {3, 4, 5});
+  InstrProfRecord Record3("callee1", 0x1236, {6});
+
+  Record1.reserveSites(IPVK_IndirectCallTarget, 2);
+  InstrProfValueData VD0[] = {{(uint64_t) "callee1", 1}};
+  Record1.addValueData(IPVK_IndirectCallTarget, 0, VD0, 1, nullptr);
+  Record1.addValueData(IPVK_IndirectCallTarget, 1, nullptr, 0, nullptr);
+  Record2.reserveSites(IPVK_IndirectCallTarget, 1);
+  InstrProfValueData VD1[] = {{(uint64_t) "callee1", 7}};
+  Record2.addValueData(IPVK_IndirectCallTarget, 0, VD1, 1, nullptr);
+
+  Writer.addRecord(std::move(Record1));
+  Writer.addRecord(std::move(Record2));
+  Writer.addRecord(std::move(Record3));
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+
+  // The counts of the second record are found past the value data of the
+  // first one.
+  std::vector<uint64_t> Counts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("caller", 0x1235, Counts)));
+  ASSERT_EQ(3U, Counts.size());
+  ASSERT_EQ(3U, Counts[0]);
+  ASSERT_EQ(5U, Counts[2]);
+
+  ErrorOr<InstrProfRecord> R = Reader->getInstrProfRecord("caller", 0x1235);
+  ASSERT_TRUE(NoError(R.getError()));
+  ASSERT_EQ(3U, R.get().Counts.size());
+  ASSERT_EQ(1U, R.get().getNumValueSites(IPVK_IndirectCallTarget));
+  ASSERT_EQ(1U, R.get().getNumValueDataForSite(IPVK_IndirectCallTarget, 0));
+  std::unique_ptr<InstrProfValueData[]> VD =
+      R.get().getValueForSite(IPVK_IndirectCallTarget, 0);
+  ASSERT_EQ(7U, VD[0].Count);
+
+  R = Reader->getInstrProfRecord("caller", 0x1234);
+  ASSERT_TRUE(NoError(R.getError()));
+  ASSERT_EQ(2U, R.get().getNumValueSites(IPVK_IndirectCallTarget));
+
+  ASSERT_TRUE(ErrorEquals(instrprof_error::hash_mismatch,
+                          Reader->getFunctionCounts("caller", 0x5678, Counts)));
+}
+
 TEST_F(InstrProfTest, get_icall_data_read_write) {
   InstrProfRecord Record1("caller", 0x1234, {1, 2});
   InstrProfRecord Record2("callee1", 0x1235, {3, 4});
@@ -610,6 +657,179 @@ TEST_F(InstrProfTest, get_weighted_function_counts) {
   ASSERT_EQ(20U, Counts[1]);
 }
 
+TEST_F(InstrProfTest, merge_records_from_writer) {
+  InstrProfWriter Writer2;
+  Writer.addRecord(InstrProfRecord("foo", 0x1234, {1, 2}));
+  Writer.addRecord(InstrProfRecord("bar", 0x5678, {4}));
+  Writer2.addRecord(InstrProfRecord("foo", 0x1234, {3, 4}), 2);
+  Writer2.addRecord(InstrProfRecord("foo", 0x1235, {5}));
+  Writer2.addRecord(InstrProfRecord("bar", 0x5678, {6, 7}));
+
+  std::vector<std::pair<std::error_code, std::string>> Warnings;
+  Writer.mergeRecordsFromWriter(
+      std::move(Writer2), [&](std::error_code EC, StringRef FuncName) {
+        Warnings.push_back(std::make_pair(EC, FuncName.str()));
+      });
+  ASSERT_EQ(1U, Warnings.size());
+  ASSERT_TRUE(ErrorEquals(instrprof_error::count_mismatch, Warnings[0].first));
+  ASSERT_EQ("bar", Warnings[0].second);
+
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+
+  std::vector<uint64_t> Counts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x1234, Counts)));
+  ASSERT_EQ(2U, Counts.size());
+  ASSERT_EQ(7U, Counts[0]);
+  ASSERT_EQ(10U, Counts[1]);
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x1235, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(5U, Counts[0]);
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("bar", 0x5678, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(4U, Counts[0]);
+  ASSERT_EQ(7U, Reader->getMaximumFunctionCount());
+}
+
+TEST_F(InstrProfTest, spill_and_merge_runs) {
+  std::vector<std::pair<std::error_code, std::string>> Warnings;
+  // A limit of one byte spills every record to a run of its own.
+  Writer.setMemoryLimit(1, [&](std::error_code EC, StringRef FuncName) {
+    Warnings.push_back(std::make_pair(EC, FuncName.str()));
+  });
+
+  InstrProfRecord Record1("caller", 0x1234, {1, 2});
+  Record1.reserveSites(IPVK_IndirectCallTarget, 1);
+  InstrProfValueData VD1[] = {{(uint64_t) "callee1", 1},
+                              {(uint64_t) "callee2", 2}};
+  Record1.addValueData(IPVK_IndirectCallTarget, 0, VD1, 2, nullptr);
+  InstrProfRecord Record2("caller", 0x1234, {3, 4});
+  Record2.reserveSites(IPVK_IndirectCallTarget, 1);
+  InstrProfValueData VD2[] = {{(uint64_t) "callee2", 5}};
+  Record2.addValueData(IPVK_IndirectCallTarget, 0, VD2, 1, nullptr);
+
+  ASSERT_TRUE(NoError(Writer.addRecord(std::move(Record1))));
+  ASSERT_TRUE(NoError(Writer.addRecord(InstrProfRecord("foo", 0x5678, {7}))));
+  ASSERT_TRUE(NoError(Writer.addRecord(std::move(Record2), 2)));
+  ASSERT_TRUE(NoError(Writer.addRecord(InstrProfRecord("foo", 0x5678, {1, 2}))));
+  ASSERT_TRUE(NoError(Writer.addRecord(InstrProfRecord("bar", 0x9abc, {9}))));
+
+  // Runs of another writer are merged in as well.
+  InstrProfWriter Writer2;
+  Writer2.setMemoryLimit(1);
+  ASSERT_TRUE(NoError(Writer2.addRecord(InstrProfRecord("bar", 0x9abc, {1}))));
+  Writer.mergeRecordsFromWriter(std::move(Writer2),
+                                [](std::error_code, StringRef) {});
+
+  auto Profile = Writer.writeBuffer();
+  ASSERT_EQ(1U, Warnings.size());
+  ASSERT_TRUE(ErrorEquals(instrprof_error::count_mismatch, Warnings[0].first));
+  ASSERT_EQ("foo", Warnings[0].second);
+  readProfile(std::move(Profile));
+
+  ErrorOr<InstrProfRecord> R = Reader->getInstrProfRecord("caller", 0x1234);
+  ASSERT_TRUE(NoError(R.getError()));
+  ASSERT_EQ(2U, R.get().Counts.size());
+  ASSERT_EQ(7U, R.get().Counts[0]);
+  ASSERT_EQ(10U, R.get().Counts[1]);
+  ASSERT_EQ(1U, R.get().getNumValueSites(IPVK_IndirectCallTarget));
+  ASSERT_EQ(2U, R.get().getNumValueDataForSite(IPVK_IndirectCallTarget, 0));
+  std::unique_ptr<InstrProfValueData[]> VD =
+      R.get().getValueForSite(IPVK_IndirectCallTarget, 0);
+  ASSERT_EQ(StringRef((const char *)VD[0].Value, 7), StringRef("callee2"));
+  ASSERT_EQ(12U, VD[0].Count);
+  ASSERT_EQ(StringRef((const char *)VD[1].Value, 7), StringRef("callee1"));
+  ASSERT_EQ(1U, VD[1].Count);
+
+  std::vector<uint64_t> Counts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x5678, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(7U, Counts[0]);
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("bar", 0x9abc, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(10U, Counts[0]);
+  ASSERT_EQ(10U, Reader->getMaximumFunctionCount());
+}
+
+/// Write \p W in text format and return its records sorted, as a writer that
+/// has spilled emits them in a different order than one that has not.
+static std::vector<std::string> writeSortedText(InstrProfWriter &W) {
+  std::vector<std::string> Records;
+  int FD;
+  SmallString<128> Path;
+  EXPECT_TRUE(NoError(
+      sys::fs::createTemporaryFile("instrprof-test", "proftext", FD, Path)));
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    EXPECT_TRUE(NoError(W.writeText(OS)));
+  }
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+      MemoryBuffer::getFile(Path);
+  sys::fs::remove(Path);
+  EXPECT_TRUE(NoError(BufferOrErr.getError()));
+  if (!BufferOrErr)
+    return Records;
+
+  SmallVector<StringRef, 64> Split;
+  BufferOrErr.get()->getBuffer().split(Split, "\n\n", -1, false);
+  for (StringRef Record : Split)
+    Records.push_back(Record);
+  std::sort(Records.begin(), Records.end());
+  return Records;
+}
+
+/// Read the indexed profile \p Profile back and return its records in the
+/// form of writeSortedText.
+static std::vector<std::string>
+readSortedText(std::unique_ptr<MemoryBuffer> Profile) {
+  auto ReaderOrErr = IndexedInstrProfReader::create(std::move(Profile));
+  EXPECT_TRUE(NoError(ReaderOrErr.getError()));
+  if (!ReaderOrErr)
+    return std::vector<std::string>();
+  InstrProfWriter W;
+  for (auto &I : *ReaderOrErr.get())
+    EXPECT_TRUE(NoError(W.addRecord(std::move(I))));
+  return writeSortedText(W);
+}
+
+TEST_F(InstrProfTest, spilled_output_matches_unlimited_output) {
+  // Records that are merged across several runs, some with indirect call
+  // targets that are added to an existing record by later merges.
+  std::vector<std::string> Names;
+  for (unsigned F = 0; F < 100; ++F)
+    Names.push_back("func" + utostr(F));
+  auto AddRecords = [&](InstrProfWriter &W) {
+    for (unsigned Round = 0; Round < 3; ++Round)
+      for (unsigned F = 0; F < 100; ++F) {
+        InstrProfRecord Record(Names[F], F % 3, {F + Round + 1, Round});
+        if (F % 5 == 0) {
+          Record.reserveSites(IPVK_IndirectCallTarget, 2);
+          for (unsigned Site = 0; Site < 2; ++Site) {
+            InstrProfValueData VD[] = {
+                {IndexedInstrProf::ComputeHash(Names[(F + Round) % 100]),
+                 Round + Site + 1}};
+            Record.addValueData(IPVK_IndirectCallTarget, Site, VD, 1, nullptr);
+          }
+        }
+        ASSERT_TRUE(NoError(W.addRecord(std::move(Record), Round + 1)));
+      }
+  };
+
+  InstrProfWriter Spilled;
+  // Small enough to spill many times over the 300 records.
+  Spilled.setMemoryLimit(1024);
+  AddRecords(Spilled);
+  AddRecords(Writer);
+
+  std::vector<std::string> Expected = writeSortedText(Writer);
+  ASSERT_EQ(100U, Expected.size());
+  ASSERT_EQ(Expected, writeSortedText(Spilled));
+  ASSERT_EQ(Expected, readSortedText(Writer.writeBuffer()));
+  ASSERT_EQ(Expected, readSortedText(Spilled.writeBuffer()));
+}
+
 TEST_F(InstrProfTest, instr_prof_symtab_test) {
   std::vector<StringRef> FuncNames;
   FuncNames.push_back("func1");
@@ -99,6 +99,62 @@ TEST_F(SampleProfTest, roundtrip_binary_profile) {
   testRoundTrip(SampleProfileFormat::SPF_Binary);
 }
 
+TEST_F(SampleProfTest, read_single_functions_from_binary_profile) {
+  createWriter(SampleProfileFormat::SPF_Binary);
+
+  FunctionSamples FooSamples;
+  FooSamples.addTotalSamples(7711);
+  FooSamples.addHeadSamples(610);
+  FooSamples.addBodySamples(1, 0, 610);
+  FooSamples.addCalledTargetSamples(2, 0, "_Z3bari", 100);
+
+  FunctionSamples BarSamples;
+  BarSamples.addTotalSamples(20301);
+  BarSamples.addHeadSamples(1437);
+  BarSamples.addBodySamples(1, 0, 1437);
+
+  FunctionSamples BazSamples;
+  BazSamples.addTotalSamples(12);
+  BazSamples.addBodySamples(3, 1, 12);
+
+  StringMap<FunctionSamples> Profiles;
+  Profiles["_Z3fooi"] = std::move(FooSamples);
+  Profiles["_Z3bari"] = std::move(BarSamples);
+  Profiles["_Z3bazi"] = std::move(BazSamples);
+
+  ASSERT_TRUE(NoError(Writer->write(Profiles)));
+  Writer->getOutputStream().flush();
+
+  auto Profile = MemoryBuffer::getMemBufferCopy(Data);
+  readProfile(Profile);
+
+  StringRef FuncNames[] = {"_Z3bazi", "_Z3fooi", "_Z3quxi"};
+  ASSERT_TRUE(NoError(Reader->readFunctions(FuncNames)));
+
+  // Only the requested functions that are in the profile are read, but the
+  // total covers the whole profile.
+  StringMap<FunctionSamples> &ReadProfiles = Reader->getProfiles();
+  ASSERT_EQ(2u, ReadProfiles.size());
+  ASSERT_EQ(0u, ReadProfiles.count("_Z3bari"));
+  ASSERT_EQ(7711u + 20301u + 12u, Reader->getTotalSamples());
+
+  FunctionSamples &ReadFooSamples = ReadProfiles["_Z3fooi"];
+  ASSERT_EQ(7711u, ReadFooSamples.getTotalSamples());
+  ASSERT_EQ(610u, ReadFooSamples.getHeadSamples());
+  ErrorOr<uint64_t> FooCallSamples = ReadFooSamples.findSamplesAt(2, 0);
+  ASSERT_FALSE(FooCallSamples.getError());
+
+  FunctionSamples &ReadBazSamples = ReadProfiles["_Z3bazi"];
+  ASSERT_EQ(12u, ReadBazSamples.getTotalSamples());
+  ErrorOr<uint64_t> BazBodySamples = ReadBazSamples.findSamplesAt(3, 1);
+  ASSERT_FALSE(BazBodySamples.getError());
+  ASSERT_EQ(12u, BazBodySamples.get());
+
+  // Reading the whole profile afterwards still works.
+  ASSERT_TRUE(NoError(Reader->read()));
+  ASSERT_EQ(3u, Reader->getProfiles().size());
+}
+
 TEST_F(SampleProfTest, sample_overflow_saturation) {
   const uint64_t Max = std::numeric_limits<uint64_t>::max();
   sampleprof_error Result;